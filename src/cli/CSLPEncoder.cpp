@@ -17,13 +17,29 @@ int main(const int argc, char **argv) {
                                                             cxxopts::value<std::string>())(
             "o,output", "Path where to output video file", cxxopts::value<std::string>())(
             "m,golomb_m", "Golomb m parameter, if not provided will pick a good one",
-            cxxopts::value<uint8_t>()->default_value("0"))("b,block_size", "Block size",
+            cxxopts::value<uint8_t>()->default_value("0"))(
+            "e,entropy", "Entropy coder of the residuals, 'golomb', 'rans' or 'cabac'",
+            cxxopts::value<std::string>()->default_value("golomb"))("b,block_size", "Block size",
                                                            cxxopts::value<uint8_t>()->default_value("16"))(
             "p,period", "Period", cxxopts::value<uint8_t>()->default_value("5"))(
             "search,search_radius", "Search radius, if not provided will use faster search", cxxopts::value<uint8_t>())(
             "y,y_quantizer", "Y quantizer", cxxopts::value<uint8_t>())("u,u_quantizer", "U quantizer",
                                                                        cxxopts::value<uint8_t>())(
-            "v,v_quantizer", "V quantizer", cxxopts::value<uint8_t>())("h,help", "Print usage");
+            "v,v_quantizer", "V quantizer", cxxopts::value<uint8_t>())(
+            "speculative", "Threads decoding each lossless_intra frame speculatively, needs a Golomb m",
+            cxxopts::value<int>()->default_value("0"))(
+            "wavefront", "Code every row of intra frames on its own, so they can be decoded in parallel",
+            cxxopts::value<bool>()->default_value("false"))(
+            "slices", "Number of slices of every frame, coded on their own so they can be coded in parallel",
+            cxxopts::value<int>()->default_value("1"))(
+            "tiles", "Number of tiles of every slice, bands of columns coded on their own like slices",
+            cxxopts::value<int>()->default_value("1"))(
+            "predictors", "Pick the intra predictor of every 16x16 block, for lossless_intra with a Golomb m",
+            cxxopts::value<bool>()->default_value("false"))(
+            "temporal", "Predict every sample of lossless_hybrid inter frames from the previous frame, without motion search",
+            cxxopts::value<bool>()->default_value("false"))(
+            "write-queue", "Blocks of the encoded file that may wait for the disk, written on a background thread if above 0",
+            cxxopts::value<size_t>()->default_value("0"))("h,help", "Print usage");
     cout << endl;
     const auto result = options.parse(argc, argv);
     if (result.count("help")) {
@@ -39,6 +55,7 @@ int main(const int argc, char **argv) {
     const auto input = result["input"].as<string>();
     const auto output = result["output"].as<string>();
     const auto m = result["m"].as<uint8_t>();
+    const auto entropy = result["entropy"].as<string>();
     const auto compare = result["compare"].as<bool>();
     if (compare) {
         Video vid1(input.c_str());
@@ -54,16 +71,20 @@ int main(const int argc, char **argv) {
         return 1;
     }
     if (mode == "encode") {
+        if (entropy != "golomb" && entropy != "rans" && entropy != "cabac") {
+            cout << "[E] Invalid entropy coder requested" << endl;
+            cout << "    Valid entropy coders are 'golomb', 'rans' and 'cabac'" << endl;
+            return 1;
+        }
+        if (entropy == "rans" && codec == "intra") {
+            cout << "[E] Lossy intra encoding only supports the golomb and cabac entropy coders" << endl;
+            return 1;
+        }
         const bool lossless = codec.substr(0, 8) == "lossless";
         Encoder *encoder = nullptr;
         if (lossless) {
             if (codec == "lossless_intra") { encoder = new LosslessIntraEncoder(input.c_str(), output.c_str(), m); }
             if (codec == "lossless_hybrid") {
-                if (m == 0) {
-                    cout << "[E] Golomb m parameter is required for lossless hybrid encoding" << endl;
-                    cout << "    A value between 2 and 16 is reasonable" << endl;
-                    return 1;
-                }
                 const auto b = result["block_size"].as<uint8_t>();
                 const auto p = result["period"].as<uint8_t>();
                 encoder = new LosslessHybridEncoder(input.c_str(), output.c_str(), m, b, p);
@@ -79,8 +100,8 @@ int main(const int argc, char **argv) {
             auto v = result["v"].as<uint8_t>();
             cout << "[I] Quantizing steps: Y=" << static_cast<int>(y) << ", U=" << static_cast<int>(u)
                  << ", V=" << static_cast<int>(v) << endl;
-            if (m == 0) {
-                cout << "[E] Golomb m parameter is required for lossy encoding" << endl;
+            if (m == 0 && codec == "intra" && entropy == "golomb") {
+                cout << "[E] Golomb m parameter is required for lossy intra encoding" << endl;
                 cout << "    A value between 2 and 16 is reasonable" << endl;
                 return 1;
             }
@@ -104,11 +125,22 @@ int main(const int argc, char **argv) {
             cout << "    Valid codecs are 'lossless_intra', 'lossless_hybrid', 'intra' and 'hybrid'" << endl;
             return 1;
         }
+        encoder->entropy_coder = entropy == "rans" ? RANS : entropy == "cabac" ? CABAC : GOLOMB;
+        encoder->wavefront = result["wavefront"].as<bool>();
+        encoder->slices = result["slices"].as<int>();
+        encoder->tiles = result["tiles"].as<int>();
+        encoder->block_predictors = result["predictors"].as<bool>();
+        encoder->temporal = result["temporal"].as<bool>();
+        encoder->write_queue = result["write-queue"].as<size_t>();
         cout << "[I] Starting encoding with " << codec << " codec" << endl;
         const auto start = clock();
         encoder->encode();
         const auto end = clock();
         cout << "[I] Encoding took " << (end - start) / static_cast<double>(CLOCKS_PER_SEC) << " seconds" << endl;
+        if (encoder->write_queue > 0) {
+            cout << "[I] Waited for the disk " << encoder->write_stalls << " times, for " << encoder->write_stall_time
+                 << " seconds" << endl;
+        }
         delete encoder;
         return 0;
     }
@@ -116,7 +148,9 @@ int main(const int argc, char **argv) {
 
         Encoder *decoder;
         if (codec == "lossless_intra") {
-            decoder = new LosslessIntraEncoder(input.c_str(), output.c_str());
+            const auto intra = new LosslessIntraEncoder(input.c_str(), output.c_str());
+            intra->speculative_threads = result["speculative"].as<int>();
+            decoder = intra;
         } else if (codec == "lossless_hybrid") {
             decoder = new LosslessHybridEncoder(input.c_str(), output.c_str());
         } else if (codec == "hybrid") {
@@ -0,0 +1,66 @@
+/**
+ * @file BlockCoders.hpp
+ * @brief BlockCoders struct
+ * @ingroup Codec
+ * Declares the sets of block coders that stand in for GolombCoders when a stream is coded with rANS or CABAC.
+ */
+
+#pragma once
+#include "../io/Cabac.hpp"
+#include "../io/Rans.hpp"
+#include "Header.hpp"
+#include <array>
+
+/**
+ * \brief A block coder for each class of syntax element, used in place of GolombCoders
+ * \details The values of a frame are given to the coders, and end_frame codes every class as a block of its own, with
+ * its own frequency table or probabilities. begin_frame loads the blocks of the next frame, before it is decoded.
+ * \tparam Coder Rans or Cabac
+ */
+template<typename Coder>
+struct BlockCoders {
+    Coder mv_x;                //!< horizontal motion vector components
+    Coder mv_y;                //!< vertical motion vector components
+    std::array<Coder, 3> inter;//!< inter residuals of each channel
+    std::array<Coder, 3> intra;//!< intra residuals of each channel
+
+    /**
+     * \brief Ends encoding a frame, writing the values of every class
+     * \param bs BitStream to write to
+     */
+    void end_frame(BitStream &bs) {
+        mv_x.write(bs);
+        mv_y.write(bs);
+        for (auto &coder: inter) { coder.write(bs); }
+        for (auto &coder: intra) { coder.write(bs); }
+    }
+    /**
+     * \brief Starts decoding a frame, reading the values of every class
+     * \param bs BitStream to read from
+     */
+    void begin_frame(BitStream &bs) {
+        mv_x.read(bs);
+        mv_y.read(bs);
+        for (auto &coder: inter) { coder.read(bs); }
+        for (auto &coder: intra) { coder.read(bs); }
+    }
+};
+
+using RansCoders = BlockCoders<Rans>;  //!< Static rANS, with frequency tables sent with every frame
+using CabacCoders = BlockCoders<Cabac>;//!< Adaptive binary arithmetic coding, with probabilities reset every frame
+
+/**
+ * \brief Calls a function with the block coders of an entropy coder
+ * \param coder RANS or CABAC
+ * \param f generic callable, called with RansCoders or CabacCoders
+ */
+template<typename F>
+void withBlockCoders(const ENTROPY_CODER coder, F &&f) {
+    if (coder == RANS) {
+        RansCoders coders;
+        std::forward<F>(f)(coders);
+    } else {
+        CabacCoders coders;
+        std::forward<F>(f)(coders);
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file BlockKernel.hpp
+ * @brief BlockKernel struct
+ * @ingroup Codec
+ * Declares the kernels of motion compensation, which compare, subtract and add the blocks of frames with 1 or 3 channels.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <opencv2/core/mat.hpp>
+#include <utility>
+
+/**
+ * \brief Kernels on the blocks of a frame, for a given number of channels
+ * \details Blocks are regions of their frame, so their rows are not contiguous and are walked one at a time. Within a
+ * row the channels of the pixels are handled as a flat run of cols * Channels samples, so the loops have a bound known
+ * at compile time but for the block width, and a single channel frame does a third of the work of a BGR one.
+ * \tparam Channels number of channels of the frame, 1 or 3
+ */
+template<int Channels>
+struct BlockKernel {
+    static constexpr int CHANNELS = Channels;///< Number of channels of the frame
+
+    /**
+     * \brief Sum of the absolute differences of two blocks of 8 bit samples
+     * \param a first block
+     * \param b second block, of the same size
+     * \return the sum over every sample of every channel
+     */
+    static int sad(const cv::Mat &a, const cv::Mat &b) {
+        const int n = a.cols * Channels;
+        int sum = 0;
+        for (int r = 0; r < a.rows; r++) {
+            const uint8_t *row_a = a.ptr<uint8_t>(r);
+            const uint8_t *row_b = b.ptr<uint8_t>(r);
+            for (int i = 0; i < n; i++) { sum += std::abs(row_a[i] - row_b[i]); }
+        }
+        return sum;
+    }
+
+    /**
+     * \brief Sum of the squared differences of two blocks of 8 bit samples
+     * \param a first block
+     * \param b second block, of the same size
+     * \return the sum over every sample of every channel
+     */
+    static int64_t ssd(const cv::Mat &a, const cv::Mat &b) {
+        const int n = a.cols * Channels;
+        int64_t sum = 0;
+        for (int r = 0; r < a.rows; r++) {
+            const uint8_t *row_a = a.ptr<uint8_t>(r);
+            const uint8_t *row_b = b.ptr<uint8_t>(r);
+            for (int i = 0; i < n; i++) {
+                const int diff = row_a[i] - row_b[i];
+                sum += diff * diff;
+            }
+        }
+        return sum;
+    }
+
+    /**
+     * \brief Subtracts a reference block from a block
+     * \param block block of 8 bit samples
+     * \param reference reference block, of the same size
+     * \param residual 16 bit matrix of the same size and channels, where the differences are stored
+     */
+    static void residual(const cv::Mat &block, const cv::Mat &reference, cv::Mat &residual) {
+        const int n = block.cols * Channels;
+        for (int r = 0; r < block.rows; r++) {
+            const uint8_t *row = block.ptr<uint8_t>(r);
+            const uint8_t *row_reference = reference.ptr<uint8_t>(r);
+            auto *row_residual = residual.ptr<int16_t>(r);
+            for (int i = 0; i < n; i++) { row_residual[i] = static_cast<int16_t>(row[i] - row_reference[i]); }
+        }
+    }
+
+    /**
+     * \brief Adds a residual to a reference block
+     * \param reference reference block of 8 bit samples
+     * \param residual 16 bit residual of the same size and channels
+     * \param block 8 bit block of the same size, where the sums are stored
+     */
+    static void reconstruct(const cv::Mat &reference, const cv::Mat &residual, cv::Mat &block) {
+        const int n = reference.cols * Channels;
+        for (int r = 0; r < reference.rows; r++) {
+            const uint8_t *row_reference = reference.ptr<uint8_t>(r);
+            const auto *row_residual = residual.ptr<int16_t>(r);
+            uint8_t *row = block.ptr<uint8_t>(r);
+            for (int i = 0; i < n; i++) { row[i] = static_cast<uint8_t>(row_reference[i] + row_residual[i]); }
+        }
+    }
+};
+
+/**
+ * \brief Calls a function with the block kernel of a channel count
+ * \param channels 1 or 3
+ * \param f generic callable, called with a BlockKernel
+ * \return what f returns
+ */
+template<typename F>
+auto withBlockKernel(const int channels, F &&f) {
+    if (channels == 1) { return std::forward<F>(f)(BlockKernel<1>()); }
+    return std::forward<F>(f)(BlockKernel<3>());
+}
@@ -0,0 +1,54 @@
+/**
+ * @file ColorTransform.hpp
+ * @brief Reversible colour transform
+ * @ingroup Codec
+ * Declares the YCoCg-R transform, which the lossless codecs apply to the residuals of BGR frames.
+ */
+
+#pragma once
+#include <cstddef>
+
+/**
+ * \brief Transforms the residuals of BGR pixels into YCoCg-R, in place
+ * \details The transform is made of integer lifting steps, so it is exactly undone by inverse_ycocg whatever the
+ * values. Applied to the residuals, after prediction, it removes what the prediction errors of the three channels have
+ * in common, and the samples themselves stay 8 bit for the prediction kernels. Y ends up in channel 0, Co in channel 1
+ * and Cg in channel 2.
+ * \tparam T type of the residuals, which needs two more bits than the residuals of a channel
+ * \param pixels residuals of the pixels, three channels to a pixel in BGR order
+ * \param count number of pixels
+ */
+template<typename T>
+void forward_ycocg(T *pixels, const size_t count) {
+    for (size_t i = 0; i < count * 3; i += 3) {
+        const int b = pixels[i];
+        const int g = pixels[i + 1];
+        const int r = pixels[i + 2];
+        const int co = r - b;
+        const int t = b + (co >> 1);
+        const int cg = g - t;
+        pixels[i] = static_cast<T>(t + (cg >> 1));
+        pixels[i + 1] = static_cast<T>(co);
+        pixels[i + 2] = static_cast<T>(cg);
+    }
+}
+
+/**
+ * \brief Transforms YCoCg-R residuals back into the residuals of BGR pixels, in place
+ * \tparam T type of the residuals
+ * \param pixels residuals written by forward_ycocg
+ * \param count number of pixels
+ */
+template<typename T>
+void inverse_ycocg(T *pixels, const size_t count) {
+    for (size_t i = 0; i < count * 3; i += 3) {
+        const int y = pixels[i];
+        const int co = pixels[i + 1];
+        const int cg = pixels[i + 2];
+        const int t = y - (cg >> 1);
+        const int b = t - (co >> 1);
+        pixels[i] = static_cast<T>(b);
+        pixels[i + 1] = static_cast<T>(cg + t);
+        pixels[i + 2] = static_cast<T>(b + co);
+    }
+}
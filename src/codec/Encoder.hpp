@@ -5,6 +5,7 @@
 */
 
 #pragma once
+#include "../io/AsyncWriter.hpp"
 #include "../visual/Image.hpp"
 #include "../visual/Video.hpp"
 #include "Frame.hpp"
@@ -16,6 +17,16 @@ class Encoder {
 public:
     virtual ~Encoder() = default;
     std::vector<Frame> frames;
+    ENTROPY_CODER entropy_coder = GOLOMB;///< Entropy coder of the residuals, for the encoders that support it
+    bool wavefront = false;              ///< Whether intra frames get a substream per row, for the encoders that support it
+    int slices = 1;                      ///< Number of slices of every frame, for the encoders that support it
+    int tiles = 1;                       ///< Number of tiles of every slice, for the encoders that support slices
+    bool block_predictors = false;       ///< Whether intra frames pick a predictor for every block, for the encoders that support it
+    bool color_transform = true;         ///< Whether the residuals of BGR frames are coded in YCoCg-R, for the lossless encoders
+    bool temporal = false;               ///< Whether inter frames are predicted from the previous frame without motion search, for the lossless hybrid encoder
+    size_t write_queue = 0;              ///< Blocks of the encoded file that may wait for the disk on a background thread, 0 to write on the encoding thread
+    size_t write_stalls = 0;             ///< Times encoding waited for the background writer, set by encode
+    double write_stall_time = 0;         ///< Seconds encoding waited for the background writer, set by encode
     /**
      * @brief Encodes a video.
      * @details This method should be implemented by the subclass.
@@ -28,19 +39,92 @@ public:
      * @return The decoded video.
      */
     virtual void decode() = 0;
+    /**
+     * @brief Opens the file an encoder writes to.
+     * @details With a write queue, filled blocks are written by an AsyncWriter, so encoding only waits for the disk when
+     * the queue is full.
+     * @param path Path to the file.
+     * @return The stream, to be closed with close_output.
+     */
+    std::unique_ptr<BitStream> open_output(const char *path) const {
+        if (write_queue > 0) { return std::unique_ptr<BitStream>(new BitStream(path, write_queue)); }
+        return std::unique_ptr<BitStream>(new BitStream(path, std::ios::out));
+    }
+    /**
+     * @brief Writes what is left of the file an encoder wrote to, and records how long it waited for the disk.
+     * @param bs Stream opened by open_output.
+     * @throws runtime_error A write failed.
+     */
+    void close_output(BitStream &bs) {
+        bs.flushBuffer();
+        if (const AsyncWriter *writer = bs.getWriter()) {
+            write_stalls = writer->getStallCount();
+            write_stall_time = writer->getStallTime();
+        }
+    }
 };
 
+/**
+ * @brief Encodes frames on OpenMP threads, each into a BitStream of its own, and writes them in order as they are done.
+ * @details A frame is written as soon as every frame before it has been, so an output with a write queue reaches the
+ * disk while later frames are still being encoded, and only the frames in flight are held in memory.
+ * @param count Number of frames.
+ * @param encode Callable taking the index of a frame and the in-memory BitStream to encode it into.
+ * @param write Callable taking the BitStream of a frame, called in the order of the frames.
+ */
+template<typename Encode, typename Write>
+void encodeInOrder(const size_t count, Encode &&encode, Write &&write) {
+#pragma omp parallel for default(none) shared(count, encode, write) ordered schedule(dynamic, 1)
+    for (size_t index = 0; index < count; index++) {
+        BitStream stream;
+        encode(index, stream);
+#pragma omp ordered
+        write(stream);
+    }
+}
+
 /**
  * @brief Samples frames from a vector of frames.
+ * @details The frames are split into equal strata and the middle frame of each is taken, so the sample is
+ * deterministic, spread over the whole video and free of duplicates.
  * @param frames Vector of frames to sample from.
  * @param sample_factor Factor to sample by.
- * @return Vector of sampled frames.
+ * @return Vector of sampled frames, at least one if there are any frames.
  */
-inline std::vector<Frame *> sample_frames(const std::vector<Frame *> &frames, int sample_factor) {
+inline std::vector<Frame *> sample_frames(const std::vector<Frame *> &frames, const int sample_factor) {
     std::vector<Frame *> sample;
-    for (int i = 0; i < frames.size() / sample_factor; i++) {
-        Frame *frame = frames[rand() % frames.size()];
-        sample.push_back(frame);
-    }
+    const size_t count = (frames.size() + sample_factor - 1) / sample_factor;
+    for (size_t i = 0; i < count; i++) { sample.push_back(frames[(2 * i + 1) * frames.size() / (2 * count)]); }
     return sample;
+}
+
+/**
+ * @brief Picks the Golomb parameters of each class of syntax element from a sample of frames.
+ * @details The residuals are read in place, one sampled frame per thread, and the statistics are merged.
+ * @param intra_frames Intra frames, with their intra encoding.
+ * @param inter_frames Inter frames, with their motion vectors or their temporal residuals.
+ * @param sample_factor Factor to sample by.
+ * @return The parameters that code the sample in the fewest bits.
+ */
+inline GolombParameters estimate_golomb_parameters(const std::vector<Frame *> &intra_frames,
+                                                   const std::vector<Frame *> &inter_frames, const int sample_factor) {
+    std::vector<Frame *> sampled = sample_frames(intra_frames, sample_factor);
+    const auto inter = sample_frames(inter_frames, sample_factor);
+    sampled.insert(sampled.end(), inter.begin(), inter.end());
+    std::vector<GolombStatistics> statistics(sampled.size());
+#pragma omp parallel for default(none) shared(sampled, statistics)
+    for (size_t index = 0; index < sampled.size(); index++) {
+        const Frame &frame = *sampled[index];
+        const int channels = frame.get_image().get_image_mat()->channels();
+        if (frame.get_type() == I_FRAME) {
+            statistics[index].add_intra(frame.get_intra_encoding(), channels);
+        } else if (frame.get_motion_vectors().empty()) {
+            statistics[index].add_temporal(frame.get_intra_encoding(), channels);
+        } else {
+            statistics[index].add_inter(frame);
+        }
+    }
+    GolombStatistics total;
+    for (auto &frame_statistics: statistics) { total.merge(frame_statistics); }
+    return total.parameters();
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+/**
+ * @file EntropyCoder.hpp
+ * @brief EntropyCoder policy
+ * @ingroup Codec
+ * Describes the entropy coder policy the codecs are written against, and picks the implementation a stream uses.
+ * Also codes the slices of a frame, each with coders of its own.
+ */
+
+#pragma once
+#include "BlockCoders.hpp"
+#include "GolombParameters.hpp"
+#include "Header.hpp"
+#include "Slices.hpp"
+#include <utility>
+
+/**
+ * \brief Runs f with the entropy coders of a stream
+ * \details The codecs are templates over the set of coders they are given, so no symbol goes through a virtual call.
+ * A set of coders (GolombCoders, RansCoders or CabacCoders) provides:
+ * - mv_x, mv_y, inter and intra: a coder for each class of syntax element, which is its context, each with
+ * encode(int), encode_span(values, count), decode() and decode_span(values, count)
+ * - begin_frame(bs): loads whatever the coders need to decode the next frame
+ * - end_frame(bs): writes whatever the coders held back from the frame
+ *
+ * GolombCoders write and read their codes as they go, BlockCoders code every frame as a block per class. The header's
+ * entropy_coder tells the decoder which set was used.
+ * \param coder the entropy coder
+ * \param bs BitStream the Golomb coders write to or read from
+ * \param parameters m of each class of syntax element, for the Golomb coders
+ * \param limit quotient limit of the Golomb codes, 0 for unlimited codes
+ * \param f generic callable, called with the set of coders
+ */
+template<typename F>
+void withEntropyCoders(const ENTROPY_CODER coder, BitStream *bs, const GolombParameters &parameters, const int limit,
+                       F &&f) {
+    if (coder == GOLOMB) {
+        withGolombCoders(bs, parameters, limit, std::forward<F>(f));
+    } else {
+        withBlockCoders(coder, std::forward<F>(f));
+    }
+}
+
+/**
+ * \brief Writes a frame tile by tile, each tile with coders of its own
+ * \details A frame with a single tile is written straight to bs, as if it had no slices. Otherwise every tile is coded
+ * into a BitStream of its own, on OpenMP threads, and the tiles are then written as Substreams.
+ * \param bs BitStream to write to
+ * \param coder the entropy coder
+ * \param parameters m of each class of syntax element, for the Golomb coders
+ * \param limit quotient limit of the Golomb codes, 0 for unlimited codes
+ * \param slices slices and tiles of the frame
+ * \param f generic callable, called with the set of coders of a tile and the index of the tile
+ */
+template<typename F>
+void writeSlices(BitStream &bs, const ENTROPY_CODER coder, const GolombParameters &parameters, const int limit,
+                 const Slices &slices, F &&f) {
+    if (slices.count() == 1) {
+        withEntropyCoders(coder, &bs, parameters, limit, [&bs, &f](auto &g) {
+            f(g, 0);
+            g.end_frame(bs);
+        });
+        return;
+    }
+    std::vector<BitStream> parts(slices.count());
+    slices.run([&](const int tile) {
+        withEntropyCoders(coder, &parts[tile], parameters, limit, [&](auto &g) {
+            f(g, tile);
+            g.end_frame(parts[tile]);
+        });
+    });
+    Substreams::write(bs, parts);
+}
+
+/**
+ * \brief Reads a frame written by writeSlices, its tiles on OpenMP threads
+ * \param bs BitStream to read from
+ * \param coder the entropy coder
+ * \param parameters m of each class of syntax element, for the Golomb coders
+ * \param limit quotient limit of the Golomb codes, 0 for unlimited codes
+ * \param slices slices and tiles of the frame
+ * \param f generic callable, called with the set of coders of a tile and the index of the tile
+ */
+template<typename F>
+void readSlices(BitStream &bs, const ENTROPY_CODER coder, const GolombParameters &parameters, const int limit,
+                const Slices &slices, F &&f) {
+    if (slices.count() == 1) {
+        withEntropyCoders(coder, &bs, parameters, limit, [&bs, &f](auto &g) {
+            g.begin_frame(bs);
+            f(g, 0);
+        });
+        return;
+    }
+    Substreams streams;
+    streams.read(bs, slices.count());
+    slices.run([&](const int tile) {
+        BitStream in(streams.data(tile), streams.size(tile));
+        withEntropyCoders(coder, &in, parameters, limit, [&](auto &g) {
+            g.begin_frame(in);
+            f(g, tile);
+        });
+    });
+}
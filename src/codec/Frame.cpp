@@ -1,4 +1,13 @@
 #include "Frame.hpp"
+#include "../io/Rice.hpp"
+#include "../io/SpeculativeGolomb.hpp"
+#include "BlockKernel.hpp"
+#include "ColorTransform.hpp"
+#include "IntraPredictor.hpp"
+#include "LocoI.hpp"
+#include "MedKernel.hpp"
+#include "TemporalKernel.hpp"
+#include "Wavefront.hpp"
 
 using namespace std;
 using namespace cv;
@@ -57,14 +66,9 @@ Block::MAD::MAD(const int threshold) {
     this->threshold = threshold;
 }
 double Block::MAD::block_diff(const Block &a, const Block &b) {
-    int diff = 0;
-    for (int i = 0; i < a.size_; i++) {
-        for (int j = 0; j < a.size_; j++) {
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[0] - b.block_mat_.at<Vec3b>(i, j)[0]);
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[1] - b.block_mat_.at<Vec3b>(i, j)[1]);
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[2] - b.block_mat_.at<Vec3b>(i, j)[2]);
-        }
-    }
+    const int diff = withBlockKernel(a.block_mat_.channels(), [&a, &b](auto kernel) {
+        return kernel.sad(a.block_mat_, b.block_mat_);
+    });
     return floor(diff / (a.size_ * a.size_));
 }
 bool Block::MAD::isBetter(const double score) {
@@ -77,14 +81,9 @@ Block::MSE::MSE(const int threshold) {
     this->threshold = threshold;
 }
 double Block::MSE::block_diff(const Block &a, const Block &b) {
-    double diff = 0;
-    for (int i = 0; i < a.size_; i++) {
-        for (int j = 0; j < a.size_; j++) {
-            diff += pow(a.block_mat_.at<Vec3b>(i, j)[0] - b.block_mat_.at<Vec3b>(i, j)[0], 2);
-            diff += pow(a.block_mat_.at<Vec3b>(i, j)[1] - b.block_mat_.at<Vec3b>(i, j)[1], 2);
-            diff += pow(a.block_mat_.at<Vec3b>(i, j)[2] - b.block_mat_.at<Vec3b>(i, j)[2], 2);
-        }
-    }
+    const auto diff = static_cast<double>(withBlockKernel(a.block_mat_.channels(), [&a, &b](auto kernel) {
+        return kernel.ssd(a.block_mat_, b.block_mat_);
+    }));
     return floor(diff / (a.size_ * a.size_));
 }
 bool Block::MSE::isBetter(const double score) {
@@ -112,15 +111,9 @@ Block::SAD::SAD(const int threshold) {
     this->threshold = threshold;
 }
 double Block::SAD::block_diff(const Block &a, const Block &b) {
-    double diff = 0;
-    for (int i = 0; i < a.size_; i++) {
-        for (int j = 0; j < a.size_; j++) {
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[0] - b.block_mat_.at<Vec3b>(i, j)[0]);
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[1] - b.block_mat_.at<Vec3b>(i, j)[1]);
-            diff += abs(a.block_mat_.at<Vec3b>(i, j)[2] - b.block_mat_.at<Vec3b>(i, j)[2]);
-        }
-    }
-    return diff;
+    return withBlockKernel(a.block_mat_.channels(), [&a, &b](auto kernel) {
+        return kernel.sad(a.block_mat_, b.block_mat_);
+    });
 }
 bool Block::SAD::isBetter(const double score) {
     return score < best_score;
@@ -177,156 +170,429 @@ void Frame::setType(const FrameType type) {
     type_ = type;
 }
 
+void Frame::set_color_transform(const bool color_transform) {
+    color_transform_ = color_transform && image_.get_color() == BGR;
+}
+
 void Frame::show() {
     imshow("Frame", *image_.get_image_mat());
     waitKey(0);
 }
 
-void Frame::encode_JPEG_LS() {
+void Frame::encode_JPEG_LS() { encode_JPEG_LS(Slices(image_.size().width, image_.size().height, 1)); }
+
+void Frame::encode_JPEG_LS(const Slices &slices) {
     type_ = I_FRAME;
-    Mat *image_mat_ = image_.get_image_mat();
-    for (int r = 0; r < image_mat_->rows; r++) {
-        for (int c = 0; c < image_mat_->cols; c++) {
-            for (int channel = 0; channel < image_mat_->channels(); channel++) {
-                const int real = image_mat_->at<Vec3b>(r, c)[channel];
-                const int predicted = predict_JPEG_LS(*image_mat_, r, c, channel);
-                int diff = real - predicted;
-                intra_encoding.push_back(diff);
+    const Mat &mat = *image_.get_image_mat();
+    const size_t row_size = static_cast<size_t>(mat.cols) * mat.channels();
+    const size_t start = intra_encoding.size();
+    intra_encoding.resize(start + row_size * mat.rows);
+    withMedKernel(mat.channels(), [this, &mat, &slices, row_size, start](auto kernel) {
+        for (int tile = 0; tile < slices.count(); tile++) {
+            const Mat columns = slices.tile_columns(mat, tile);
+            const size_t left = start + static_cast<size_t>(slices.left(tile)) * mat.channels();
+            for (int r = slices.begin(tile); r < slices.end(tile); r++) {
+                const uchar *above = r > slices.begin(tile) ? columns.ptr<uchar>(r - 1) : nullptr;
+                int *residuals = intra_encoding.data() + left + r * row_size;
+                kernel.residuals(columns.ptr<uchar>(r), above, columns.cols, residuals);
+                if (color_transform_) { forward_ycocg(residuals, columns.cols); }
             }
         }
-    }
+    });
+}
+
+template<typename Coder>
+void Frame::encode_JPEG_LS(const Coder &g) {
+    type_ = I_FRAME;
+    const Mat &mat = *image_.get_image_mat();
+    // Each row is predicted into a buffer and then written in one go
+    vector<int> row_encoding(static_cast<size_t>(mat.cols) * mat.channels());
+    withMedKernel(mat.channels(), [this, &mat, &g, &row_encoding](auto kernel) {
+        for (int r = 0; r < mat.rows; r++) {
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, row_encoding.data());
+            if (color_transform_) { forward_ycocg(row_encoding.data(), mat.cols); }
+            g.encode_span(row_encoding.data(), row_encoding.size());
+        }
+    });
 }
 
-void Frame::encode_JPEG_LS(const Golomb &g) {
+void Frame::encode_JPEG_LS_rows(BitStream &bs, const int m, const int golomb_limit) {
     type_ = I_FRAME;
-    Mat image_mat_ = *image_.get_image_mat();
-    for (int r = 0; r < image_mat_.rows; r++) {
-        for (int c = 0; c < image_mat_.cols; c++) {
-            for (int channel = 0; channel < image_mat_.channels(); channel++) {
-                const int real = image_mat_.at<Vec3b>(r, c)[channel];
-                const int predicted = predict_JPEG_LS(image_mat_, r, c, channel);
-                const int diff = real - predicted;
-                g.encode(diff);
+    const Mat &mat = *image_.get_image_mat();
+    vector<BitStream> rows(mat.rows);
+    vector<int> row_encoding(static_cast<size_t>(mat.cols) * mat.channels());
+    withMedKernel(mat.channels(), [this, &mat, &rows, &row_encoding, m, golomb_limit](auto kernel) {
+        for (int r = 0; r < mat.rows; r++) {
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, row_encoding.data());
+            if (color_transform_) { forward_ycocg(row_encoding.data(), mat.cols); }
+            withGolombCoder(&rows[r], m, golomb_limit, [&row_encoding](const auto &g) {
+                g.encode_span(row_encoding.data(), row_encoding.size());
+            });
+        }
+    });
+    Substreams::write(bs, rows);
+}
+
+void Frame::encode_temporal(const Frame &reference, const Slices &slices) {
+    type_ = P_FRAME;
+    motion_vectors_.clear();
+    const Mat &mat = *image_.get_image_mat();
+    Image reference_image = reference.get_image();
+    const Mat &before = *reference_image.get_image_mat();
+    const size_t row_size = static_cast<size_t>(mat.cols) * mat.channels();
+    intra_encoding.assign(row_size * mat.rows, 0);
+    withMedKernel(mat.channels(), [this, &mat, &before, &slices, row_size](auto med_kernel) {
+        for (int tile = 0; tile < slices.count(); tile++) {
+            const Mat columns = slices.tile_columns(mat, tile);
+            const Mat previous = slices.tile_columns(before, tile);
+            const size_t left = static_cast<size_t>(slices.left(tile)) * mat.channels();
+            TemporalKernel<decltype(med_kernel)::CHANNELS> kernel(columns.cols);
+            for (int r = slices.begin(tile); r < slices.end(tile); r++) {
+                const uchar *above = r > slices.begin(tile) ? columns.ptr<uchar>(r - 1) : nullptr;
+                int *residuals = intra_encoding.data() + left + r * row_size;
+                kernel.residuals(columns.ptr<uchar>(r), above, previous.ptr<uchar>(r), residuals);
+                if (color_transform_) { forward_ycocg(residuals, columns.cols); }
+            }
+        }
+    });
+}
+
+vector<uint8_t> Frame::select_predictors() const {
+    Image image = get_image();
+    const Mat &mat = *image.get_image_mat();
+    const int blocks_x = (mat.cols + PREDICTOR_BLOCK - 1) / PREDICTOR_BLOCK;
+    const int blocks_y = (mat.rows + PREDICTOR_BLOCK - 1) / PREDICTOR_BLOCK;
+    const int channels = mat.channels();
+    vector<uint8_t> predictors(static_cast<size_t>(blocks_x) * blocks_y);
+    vector<int> residuals(static_cast<size_t>(mat.cols) * channels);
+    // Sum of absolute residuals of every block of the current row of blocks, with every predictor
+    vector<long> sad(static_cast<size_t>(blocks_x) * INTRA_PREDICTORS);
+    for (int block_y = 0; block_y < blocks_y; block_y++) {
+        fill(sad.begin(), sad.end(), 0);
+        for (int r = block_y * PREDICTOR_BLOCK; r < min((block_y + 1) * PREDICTOR_BLOCK, mat.rows); r++) {
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            for (int predictor = 0; predictor < INTRA_PREDICTORS; predictor++) {
+                withPredictorKernel(channels, static_cast<INTRA_PREDICTOR>(predictor), [&](auto kernel) {
+                    kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, 0, mat.cols, residuals.data());
+                });
+                for (int i = 0; i < mat.cols * channels; i++) {
+                    sad[i / channels / PREDICTOR_BLOCK * INTRA_PREDICTORS + predictor] += abs(residuals[i]);
+                }
             }
         }
+        for (int block_x = 0; block_x < blocks_x; block_x++) {
+            // Ties go to the lower predictor, MED first
+            const auto first = sad.begin() + block_x * INTRA_PREDICTORS;
+            predictors[block_y * blocks_x + block_x] =
+                    static_cast<uint8_t>(min_element(first, first + INTRA_PREDICTORS) - first);
+        }
+    }
+    return predictors;
+}
+
+template<typename Coder>
+void Frame::encode_intra_blocks(const Coder &g, BitStream &bs) {
+    type_ = I_FRAME;
+    const Mat &mat = *image_.get_image_mat();
+    const vector<uint8_t> predictors = select_predictors();
+    for (const uint8_t predictor: predictors) { bs.writeBits(predictor, INTRA_PREDICTOR_BITS); }
+    const int blocks_x = (mat.cols + PREDICTOR_BLOCK - 1) / PREDICTOR_BLOCK;
+    vector<int> row_encoding(static_cast<size_t>(mat.cols) * mat.channels());
+    for (int r = 0; r < mat.rows; r++) {
+        const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+        const uint8_t *row_predictors = predictors.data() + r / PREDICTOR_BLOCK * blocks_x;
+        for (int block_x = 0; block_x < blocks_x; block_x++) {
+            const int begin = block_x * PREDICTOR_BLOCK;
+            const int end = min(begin + PREDICTOR_BLOCK, mat.cols);
+            const auto predictor = static_cast<INTRA_PREDICTOR>(row_predictors[block_x]);
+            withPredictorKernel(mat.channels(), predictor, [&](auto kernel) {
+                kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, begin, end, row_encoding.data());
+            });
+        }
+        if (color_transform_) { forward_ycocg(row_encoding.data(), mat.cols); }
+        g.encode_span(row_encoding.data(), row_encoding.size());
+    }
+}
+
+namespace {
+//! Writes the rows of residuals of a tile, each channel with its own coder
+template<typename Channels>
+void write_rows(Channels &coders, const vector<int> &encoding, const Size size, const Slices &slices, const int tile) {
+    const int channels = static_cast<int>(encoding.size() / (static_cast<size_t>(size.width) * size.height));
+    const int left = slices.left(tile);
+    vector<int> line(slices.right(tile) - left);
+    for (int r = slices.begin(tile); r < slices.end(tile); r++) {
+        const int *row = encoding.data() + (static_cast<size_t>(r) * size.width + left) * channels;
+        for (int channel = 0; channel < channels; channel++) {
+            for (size_t c = 0; c < line.size(); c++) { line[c] = row[c * channels + channel]; }
+            coders[channel].encode_span(line.data(), line.size());
+        }
     }
 }
 
-void Frame::write_JPEG_LS(const Golomb &g) const {
-    for (const auto diff: intra_encoding) {
-        g.encode(diff);
+//! Reads a row of residuals written by write_rows, turning YCoCg-R residuals back into BGR ones
+template<typename Channels>
+void read_row(Channels &coders, vector<int> &residuals, vector<int> &line, const int channels,
+              const bool color_transform) {
+    const int cols = static_cast<int>(line.size());
+    for (int channel = 0; channel < channels; channel++) {
+        coders[channel].decode_span(line.data(), line.size());
+        for (int c = 0; c < cols; c++) { residuals[c * channels + channel] = line[c]; }
     }
+    if (color_transform && channels == 3) { inverse_ycocg(residuals.data(), cols); }
+}
+}// namespace
+
+template<typename Coders>
+void Frame::write_JPEG_LS(Coders &g) const {
+    write_JPEG_LS(g, Slices(image_.size().width, image_.size().height, 1), 0);
+}
+
+template<typename Coders>
+void Frame::write_JPEG_LS(Coders &g, const Slices &slices, const int tile) const {
+    write_rows(g.intra, intra_encoding, image_.size(), slices, tile);
+}
+
+void Frame::write_frame(BitStream &bs, const ENTROPY_CODER coder, const GolombParameters &parameters,
+                        const int golomb_limit) const {
+    // A single slice holds every row of blocks of an inter frame, so its unit is the size of the blocks
+    const int unit = motion_vectors_.empty() ? 1 : motion_vectors_.front().residual.rows;
+    write_frame(bs, coder, parameters, golomb_limit, Slices(image_.size().width, image_.size().height, 1, 1, unit));
+}
+
+void Frame::write_frame(BitStream &bs, const ENTROPY_CODER coder, const GolombParameters &parameters,
+                        const int golomb_limit, const Slices &slices) const {
+    const size_t blocks_per_row = image_.size().width / slices.unit();
+    writeSlices(bs, coder, parameters, golomb_limit, slices, [this, &slices, blocks_per_row](auto &g, const int tile) {
+        if (type_ == P_FRAME && motion_vectors_.empty()) {
+            // Temporal residuals have the magnitude of inter residuals, so they share their coders
+            write_rows(g.inter, intra_encoding, image_.size(), slices, tile);
+        } else if (type_ == P_FRAME) {
+            slices.unit_rows(tile, blocks_per_row, [this, &g](const size_t begin, const size_t end) {
+                write(g, begin, end);
+            });
+        } else {
+            write_JPEG_LS(g, slices, tile);
+        }
+    });
 }
 
-Frame Frame::decode_JPEG_LS(Golomb &g, const Header &header) {
-    Mat mat;
+Frame Frame::read_frame(BitStream &bs, const InterHeader &header, const Slices &slices, Frame *reference) {
     const int width = static_cast<int>(header.width);
     const int height = static_cast<int>(header.height);
-    if (header.color_space == GRAY) {
-        mat = Mat::zeros(height, width, CV_8UC1);
-    } else {
-        mat = Mat::zeros(height, width, CV_8UC3);
-    }
-    for (int r = 0; r < mat.rows; r++) {
-        for (int c = 0; c < mat.cols; c++) {
-            for (int channel = 0; channel < mat.channels(); channel++) {
-                const int diff = g.decode();
-                const uchar predicted = predict_JPEG_LS(mat, r, c, channel);
-                const uchar real = diff + predicted;
-                if (mat.channels() > 1) {
-                    mat.at<Vec3b>(r, c)[channel] = real;
-                } else {
-                    mat.at<uchar>(r, c) = real;
-                }
+    const size_t blocks_per_row = width / slices.unit();
+    Mat mat(height, width, header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    const bool motion = reference != nullptr && !header.temporal;
+    vector<MotionVector> mvs(motion ? blocks_per_row * (height / slices.unit()) : 0);
+    Image reference_image = reference == nullptr ? Image() : reference->get_image();
+    readSlices(bs, header.entropy_coder, header.golomb_parameters, header.golomb_limit, slices,
+               [&](auto &g, const int tile) {
+                   Mat columns = slices.tile_columns(mat, tile);
+                   if (reference == nullptr) {
+                       decode_intra(g, columns, slices.begin(tile), slices.end(tile), header.color_transform);
+                   } else if (header.temporal) {
+                       decode_temporal(g, columns, slices.tile_columns(*reference_image.get_image_mat(), tile),
+                                       slices.begin(tile), slices.end(tile), header.color_transform);
+                   } else {
+                       slices.unit_rows(tile, blocks_per_row, [&g, &header, &mvs](const size_t begin, const size_t end) {
+                           decode_inter(g, header, mvs, begin, end);
+                       });
+                   }
+               });
+    if (motion) { return reconstruct_frame(*reference, mvs, header.block_size); }
+    Image im(mat);
+    im.set_color(header.color_space);
+    im.set_chroma(header.chroma_subsampling);
+    Frame frame(im);
+    frame.setType(reference == nullptr ? I_FRAME : P_FRAME);
+    return frame;
+}
+
+template<typename Coder>
+Frame Frame::decode_JPEG_LS(Coder &g, const Header &header) {
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    const int channels = header.color_space == GRAY ? 1 : 3;
+    vector<int> encodings(static_cast<size_t>(width) * height * channels);
+    g.decode_span(encodings.data(), encodings.size());
+    return decode_JPEG_LS(encodings, header.color_space, header.chroma_subsampling, height, width,
+                          header.color_transform);
+}
+
+Frame Frame::decode_JPEG_LS_rows(BitStream &bs, const Header &header) {
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    Mat mat(height, width, header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    const size_t row_size = static_cast<size_t>(width) * mat.channels();
+    Substreams streams;
+    streams.read(bs, height);
+    Wavefront wavefront(height);
+    withMedKernel(mat.channels(), [&](auto kernel) {
+        wavefront.run([&](const int r) {
+            // The residuals of a row don't depend on any other row, only the reconstruction does
+            vector<int> residuals(row_size);
+            BitStream in(streams.data(r), streams.size(r));
+            withGolombCoder(&in, header.golomb_m, header.golomb_limit, [&residuals](auto &g) {
+                g.decode_span(residuals.data(), residuals.size());
+            });
+            if (header.color_transform && mat.channels() == 3) { inverse_ycocg(residuals.data(), width); }
+            uchar *row = mat.ptr<uchar>(r);
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            for (int begin = 0; begin < width; begin += Wavefront::STEP) {
+                const int end = min(begin + Wavefront::STEP, width);
+                wavefront.wait(r - 1, end);
+                kernel.reconstruct(row, above, begin, end, [&residuals](const int i, const int predicted) {
+                    return static_cast<uchar>(predicted + residuals[i]);
+                });
+                wavefront.publish(r, end);
             }
+        });
+    });
+    Image im(mat);
+    im.set_color(header.color_space);
+    im.set_chroma(header.chroma_subsampling);
+    Frame frame(im);
+    frame.setType(I_FRAME);
+    return frame;
+}
+
+template<typename Coder>
+Frame Frame::decode_intra_blocks(Coder &g, BitStream &bs, const Header &header) {
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    Mat mat(height, width, header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    const int blocks_x = (width + PREDICTOR_BLOCK - 1) / PREDICTOR_BLOCK;
+    const int blocks_y = (height + PREDICTOR_BLOCK - 1) / PREDICTOR_BLOCK;
+    vector<uint8_t> predictors(static_cast<size_t>(blocks_x) * blocks_y);
+    for (uint8_t &predictor: predictors) { predictor = static_cast<uint8_t>(bs.readBits(INTRA_PREDICTOR_BITS)); }
+    const size_t row_size = static_cast<size_t>(width) * mat.channels();
+    vector<int> encodings(row_size * height);
+    g.decode_span(encodings.data(), encodings.size());
+    for (int r = 0; r < height; r++) {
+        int *residuals = encodings.data() + r * row_size;
+        if (header.color_transform && mat.channels() == 3) { inverse_ycocg(residuals, width); }
+        const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+        const uint8_t *row_predictors = predictors.data() + r / PREDICTOR_BLOCK * blocks_x;
+        for (int block_x = 0; block_x < blocks_x; block_x++) {
+            const int begin = block_x * PREDICTOR_BLOCK;
+            const int end = min(begin + PREDICTOR_BLOCK, width);
+            const auto predictor = static_cast<INTRA_PREDICTOR>(row_predictors[block_x]);
+            withPredictorKernel(mat.channels(), predictor, [&](auto kernel) {
+                kernel.reconstruct(mat.ptr<uchar>(r), above, width, begin, end, [residuals](const int i, const int predicted) {
+                    return static_cast<uchar>(predicted + residuals[i]);
+                });
+            });
         }
     }
     Image im(mat);
     im.set_color(header.color_space);
     im.set_chroma(header.chroma_subsampling);
+    Frame frame(im);
+    frame.setType(I_FRAME);
+    return frame;
+}
+
+template<typename Coders>
+Frame Frame::decode_intra(Coders &g, const Header &header) {
+    const int height = static_cast<int>(header.height);
+    Mat mat(height, static_cast<int>(header.width), header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    decode_intra(g, mat, 0, height, header.color_transform);
+    Image im(mat);
+    im.set_color(header.color_space);
+    im.set_chroma(header.chroma_subsampling);
     return Frame(im);
 }
 
-Frame Frame::decode_JPEG_LS(const vector<int> &encodings, const COLOR_SPACE color, const CHROMA_SUBSAMPLING cs_ratio, const int rows, const int cols) {
-    Mat mat;
-    if (color == GRAY) {
-        mat = Mat::zeros(rows, cols, CV_8UC1);
-    } else {
-        mat = Mat::zeros(rows, cols, CV_8UC3);
-    }
-    int i = 0;
-    for (int r = 0; r < mat.rows; r++) {
-        for (int c = 0; c < mat.cols; c++) {
-            for (int channel = 0; channel < mat.channels(); channel++) {
-                const uchar diff = encodings[i++];
-                const uchar predicted = predict_JPEG_LS(mat, r, c, channel);
-                const uchar real = diff + predicted;
-                if (mat.channels() > 1) {
-                    mat.at<Vec3b>(r, c)[channel] = real;
-                } else {
-                    mat.at<uchar>(r, c) = real;
-                }
+template<typename Coders>
+void Frame::decode_intra(Coders &g, Mat &mat, const int begin, const int end, const bool color_transform) {
+    const int channels = mat.channels();
+    vector<int> residuals(static_cast<size_t>(mat.cols) * channels);
+    vector<int> line(mat.cols);
+    withMedKernel(channels, [&](auto kernel) {
+        for (int r = begin; r < end; r++) {
+            read_row(g.intra, residuals, line, channels, color_transform);
+            const uchar *above = r > begin ? mat.ptr<uchar>(r - 1) : nullptr;
+            kernel.reconstruct(mat.ptr<uchar>(r), above, mat.cols, [&residuals](const int i, const int predicted) {
+                return static_cast<uchar>(predicted + residuals[i]);
+            });
+        }
+    });
+}
+
+template<typename Coders>
+void Frame::decode_temporal(Coders &g, Mat &mat, const Mat &reference, const int begin, const int end,
+                            const bool color_transform) {
+    const int channels = mat.channels();
+    vector<int> residuals(static_cast<size_t>(mat.cols) * channels);
+    vector<int> line(mat.cols);
+    withMedKernel(channels, [&](auto med_kernel) {
+        TemporalKernel<decltype(med_kernel)::CHANNELS> kernel(mat.cols);
+        for (int r = begin; r < end; r++) {
+            read_row(g.inter, residuals, line, channels, color_transform);
+            const uchar *above = r > begin ? mat.ptr<uchar>(r - 1) : nullptr;
+            kernel.reconstruct(mat.ptr<uchar>(r), above, reference.ptr<uchar>(r),
+                               [&residuals](const int i, const int predicted) {
+                                   return static_cast<uchar>(predicted + residuals[i]);
+                               });
+        }
+    });
+}
+
+Frame Frame::decode_JPEG_LS(const vector<int> &encodings, const COLOR_SPACE color, const CHROMA_SUBSAMPLING cs_ratio, const int rows, const int cols, const bool color_transform) {
+    Mat mat(rows, cols, color == GRAY ? CV_8UC1 : CV_8UC3);
+    const size_t row_size = static_cast<size_t>(cols) * mat.channels();
+    // YCoCg-R residuals are turned back into BGR ones a row at a time, the encodings are left as they are
+    vector<int> row(color_transform && mat.channels() == 3 ? row_size : 0);
+    withMedKernel(mat.channels(), [&mat, &encodings, &row, row_size](auto kernel) {
+        for (int r = 0; r < mat.rows; r++) {
+            const int *residuals = encodings.data() + r * row_size;
+            if (!row.empty()) {
+                copy(residuals, residuals + row_size, row.begin());
+                inverse_ycocg(row.data(), mat.cols);
+                residuals = row.data();
             }
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            kernel.reconstruct(mat.ptr<uchar>(r), above, mat.cols, [residuals](const int i, const int predicted) {
+                return static_cast<uchar>(predicted + residuals[i]);
+            });
         }
-    }
+    });
     Image im(mat);
     im.set_color(color);
     im.set_chroma(cs_ratio);
     return Frame(im);
 }
 
+void Frame::encode_LOCO_I(BitStream &bs) {
+    type_ = I_FRAME;
+    const Mat &mat = *image_.get_image_mat();
+    LocoI model(mat.channels());
+    model.encode(mat, bs);
+}
+
+Frame Frame::decode_LOCO_I(BitStream &bs, const Header &header) {
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    Mat mat = Mat::zeros(height, width, header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    LocoI model(mat.channels());
+    model.decode(mat, bs);
+    Image im(mat);
+    im.set_color(header.color_space);
+    im.set_chroma(header.chroma_subsampling);
+    Frame frame(im);
+    frame.setType(I_FRAME);
+    return frame;
+}
+
 uchar Frame::predict_JPEG_LS(Mat &mat, const int row, const int col, const int channel) {
     if (row < 0 || row >= mat.rows || col < 0 || col >= mat.cols) {
         throw std::out_of_range("Pixel out of bounds");
     }
-
-    uchar a, b, c;
-    if (mat.channels() > 1) {
-        if (row - 1 >= 0 && col >= 1) {
-            a = mat.at<Vec3b>(row, col - 1)[channel];
-            b = mat.at<Vec3b>(row - 1, col)[channel];
-            c = mat.at<Vec3b>(row - 1, col - 1)[channel];
-        } else if (row - 1 >= 0) {
-            a = 0;
-            b = mat.at<Vec3b>(row - 1, col)[channel];
-            c = 0;
-        } else if (col - 1 >= 0) {
-            a = mat.at<Vec3b>(row, col - 1)[channel];
-            b = 0;
-            c = 0;
-        } else {
-            a = 0;
-            b = 0;
-            c = 0;
-        }
-    } else {
-        if (row - 1 >= 0 && col >= 1) {
-            a = mat.at<uchar>(row, col - 1);
-            b = mat.at<uchar>(row - 1, col);
-            c = mat.at<uchar>(row - 1, col - 1);
-        } else if (row - 1 >= 0) {
-            a = 0;
-            b = mat.at<uchar>(row - 1, col);
-            c = 0;
-        } else if (col - 1 >= 0) {
-            a = mat.at<uchar>(row, col - 1);
-            b = 0;
-            c = 0;
-        } else {
-            a = 0;
-            b = 0;
-            c = 0;
-        }
-    }
-
-
-    if (c >= std::max(a, b)) {
-        return std::min(a, b);
-    }
-    if (c <= std::min(a, b)) {
-        return std::max(a, b);
-    }
-    return a + b - c;
+    const uchar *above = row > 0 ? mat.ptr<uchar>(row - 1) : nullptr;
+    if (mat.channels() == 1) { return MedKernel<1>::predict(mat.ptr<uchar>(row), above, col, channel); }
+    return MedKernel<3>::predict(mat.ptr<uchar>(row), above, col, channel);
 }
 
 std::array<int, 4> Frame::get_search_window(const Block &block, const int search_radius) const {
@@ -363,16 +629,11 @@ bool Block::BlockDiff::compare(const Block &block, const Frame &reference, const
     const double diff_value = block_diff(block, ref_block);
     if (isBetter(diff_value)) {
         MotionVector mv = {center.x - block_coords[0], center.y - block_coords[1]};
-        mv.residual = Mat::zeros(block.getBlockMat().size(), CV_16SC3);
-        for (int i = 0; i < mv.residual.rows; i++)
-            for (int j = 0; j < mv.residual.cols; j++) {
-                mv.residual.at<Vec3s>(i, j)[0] = static_cast<short>(block.getBlockMat().at<Vec3b>(i, j)[0] -
-                                                                    ref_block.getBlockMat().at<Vec3b>(i, j)[0]);
-                mv.residual.at<Vec3s>(i, j)[1] = static_cast<short>(block.getBlockMat().at<Vec3b>(i, j)[1] -
-                                                                    ref_block.getBlockMat().at<Vec3b>(i, j)[1]);
-                mv.residual.at<Vec3s>(i, j)[2] = static_cast<short>(block.getBlockMat().at<Vec3b>(i, j)[2] -
-                                                                    ref_block.getBlockMat().at<Vec3b>(i, j)[2]);
-            }
+        const int channels = block.getBlockMat().channels();
+        mv.residual = Mat(block.getBlockMat().size(), CV_MAKETYPE(CV_16S, channels));
+        withBlockKernel(channels, [&block, &ref_block, &mv](auto kernel) {
+            kernel.residual(block.getBlockMat(), ref_block.getBlockMat(), mv.residual);
+        });
         best_score = diff_value;
         best_match = mv;
     }
@@ -497,24 +758,24 @@ void Frame::calculate_MV(const Frame &reference, const int block_size, const int
 }
 
 Frame Frame::reconstruct_frame(Frame &reference, const vector<MotionVector> &motion_vectors, int block_size) {
-    Size size = reference.get_image().size();
-    Mat reconstructed = Mat::zeros(size, CV_8UC3);
-    for (int i = 0; i + block_size <= size.height; i += block_size) {
-        for (int j = 0; j + block_size <= size.width; j += block_size) {
-            MotionVector mv = motion_vectors[i / block_size * (size.width / block_size) + j / block_size];
-            Block block = get_block(reference.get_image(), block_size, i + mv.y, j + mv.x);
-            Mat reconstructed_block = Mat::zeros(block.getBlockMat().size(), CV_8UC3);
-            for (int k = 0; k < block.getBlockMat().rows; k++)
-                for (int l = 0; l < block.getBlockMat().cols; l++) {
-                    reconstructed_block.at<Vec3b>(k, l)[0] = block.getBlockMat().at<Vec3b>(k, l)[0] + mv.residual.at<Vec3s>(k, l)[0];
-                    reconstructed_block.at<Vec3b>(k, l)[1] = block.getBlockMat().at<Vec3b>(k, l)[1] + mv.residual.at<Vec3s>(k, l)[1];
-                    reconstructed_block.at<Vec3b>(k, l)[2] = block.getBlockMat().at<Vec3b>(k, l)[2] + mv.residual.at<Vec3s>(k, l)[2];
-                }
-            block.setBlockMat(reconstructed_block);
-            setSlice(reconstructed, block.getBlockMat(), i, j);
+    Image image = reference.get_image();
+    const Size size = image.size();
+    const int channels = image.get_image_mat()->channels();
+    Mat reconstructed = Mat::zeros(size, CV_MAKETYPE(CV_8U, channels));
+    withBlockKernel(channels, [&](auto kernel) {
+        for (int i = 0; i + block_size <= size.height; i += block_size) {
+            for (int j = 0; j + block_size <= size.width; j += block_size) {
+                const MotionVector &mv = motion_vectors[i / block_size * (size.width / block_size) + j / block_size];
+                const Block block = get_block(image, block_size, i + mv.y, j + mv.x);
+                // The block is rebuilt in place, its region shares the samples of the frame
+                Mat target = reconstructed(Rect(j, i, block_size, block_size));
+                kernel.reconstruct(block.getBlockMat(), mv.residual, target);
+            }
         }
-    }
+    });
     Image im(reconstructed);
+    im.set_color(image.get_color());
+    im.set_chroma(image.get_chroma());
     Frame frame(im);
     frame.setType(P_FRAME);
     return frame;
@@ -537,45 +798,117 @@ void Frame::visualize_MV(const Frame &reference, const int block_size) const {
     waitKey(0);
 }
 
-void Frame::write(const Golomb &g) const {
-    for (const auto &mv: get_motion_vectors()) {
-        g.encode(mv.x);
-        g.encode(mv.y);
-        Mat residual = mv.residual;
-        for (int row = 0; row < residual.rows; row++) {
-            for (int col = 0; col < residual.cols; col++) {
-                for (int channel = 0; channel < residual.channels(); channel++) {
-                    g.encode(residual.at<Vec3s>(row, col)[channel]);
-                }
-            }
+template<typename Coders>
+void Frame::write(Coders &g) const {
+    write(g, 0, motion_vectors_.size());
+}
+
+void Frame::coded_residual(const MotionVector &mv, vector<int> &pixels) const {
+    const Mat &residual = mv.residual;
+    const int channels = residual.channels();
+    const size_t count = static_cast<size_t>(residual.rows) * residual.cols;
+    // The residual of the block is transformed into a buffer, the motion vector keeps the BGR one
+    pixels.resize(count * channels);
+    for (int row = 0; row < residual.rows; row++) {
+        const auto *pixel = residual.ptr<int16_t>(row);
+        copy(pixel, pixel + residual.cols * channels, pixels.begin() + row * residual.cols * channels);
+    }
+    if (color_transform_ && channels == 3) { forward_ycocg(pixels.data(), count); }
+}
+
+template<typename Coders>
+void Frame::write(Coders &g, const size_t begin, const size_t end) const {
+    vector<int> plane;
+    vector<int> pixels;
+    for (size_t block = begin; block < end; block++) {
+        const MotionVector &mv = motion_vectors_[block];
+        g.mv_x.encode(mv.x);
+        g.mv_y.encode(mv.y);
+        const int channels = mv.residual.channels();
+        const size_t count = static_cast<size_t>(mv.residual.rows) * mv.residual.cols;
+        plane.resize(count);
+        coded_residual(mv, pixels);
+        for (int channel = 0; channel < channels; channel++) {
+            for (size_t i = 0; i < count; i++) { plane[i] = pixels[i * channels + channel]; }
+            g.inter[channel].encode_span(plane.data(), plane.size());
         }
     }
 }
 
-Frame Frame::decode_inter(Golomb &g, Frame &reference, const InterHeader &header) {
-    vector<MotionVector> mvs;
+template<typename Coders>
+Frame Frame::decode_inter(Coders &g, Frame &reference, const InterHeader &header) {
     const int block_size = header.block_size;
-    const int rows = static_cast<int>(header.height);
-    const int cols = static_cast<int>(header.width);
-    for (int block_num = 0; block_num < (rows / block_size) * (cols / block_size); block_num++) {
-        MotionVector mv;
-        Mat residual;
-        if (header.color_space == GRAY) {
-            residual = Mat::zeros(block_size, block_size, CV_16SC1);
-        } else {
-            residual = Mat::zeros(block_size, block_size, CV_16SC3);
-        }
-        mv.x = g.decode();
-        mv.y = g.decode();
-        for (int row = 0; row < block_size; row++) {
-            for (int col = 0; col < block_size; col++) {
-                for (int channel = 0; channel < residual.channels(); channel++) {
-                    residual.at<Vec3s>(row, col)[channel] = static_cast<short>(g.decode());
-                }
+    const size_t blocks = (header.height / block_size) * (header.width / block_size);
+    vector<MotionVector> mvs(blocks);
+    decode_inter(g, header, mvs, 0, blocks);
+    return reconstruct_frame(reference, mvs, block_size);
+}
+
+template<typename Coders>
+void Frame::decode_inter(Coders &g, const InterHeader &header, vector<MotionVector> &mvs, const size_t begin,
+                         const size_t end) {
+    const int block_size = header.block_size;
+    const int channels = header.color_space == GRAY ? 1 : 3;
+    vector<int> plane(static_cast<size_t>(block_size) * block_size);
+    for (size_t block = begin; block < end; block++) {
+        MotionVector &mv = mvs[block];
+        mv.x = g.mv_x.decode();
+        mv.y = g.mv_y.decode();
+        mv.residual = Mat::zeros(block_size, block_size, CV_MAKETYPE(CV_16S, channels));
+        auto *residual = mv.residual.ptr<int16_t>();
+        for (int channel = 0; channel < channels; channel++) {
+            g.inter[channel].decode_span(plane.data(), plane.size());
+            for (size_t i = 0; i < plane.size(); i++) {
+                residual[i * channels + channel] = static_cast<int16_t>(plane[i]);
             }
         }
-        mv.residual = residual;
-        mvs.push_back(mv);
+        if (header.color_transform && channels == 3) { inverse_ycocg(residual, plane.size()); }
     }
-    return reconstruct_frame(reference, mvs, block_size);
-}
\ No newline at end of file
+}
+
+template void Frame::encode_JPEG_LS<Golomb>(const Golomb &);
+template void Frame::encode_JPEG_LS<Rice>(const Rice &);
+template void Frame::encode_intra_blocks<Golomb>(const Golomb &, BitStream &);
+template void Frame::encode_intra_blocks<Rice>(const Rice &, BitStream &);
+template void Frame::write_JPEG_LS<GolombCoders<Golomb>>(GolombCoders<Golomb> &) const;
+template void Frame::write_JPEG_LS<GolombCoders<Rice>>(GolombCoders<Rice> &) const;
+template void Frame::write_JPEG_LS<RansCoders>(RansCoders &) const;
+template void Frame::write_JPEG_LS<CabacCoders>(CabacCoders &) const;
+template void Frame::write_JPEG_LS<GolombCoders<Golomb>>(GolombCoders<Golomb> &, const Slices &, int) const;
+template void Frame::write_JPEG_LS<GolombCoders<Rice>>(GolombCoders<Rice> &, const Slices &, int) const;
+template void Frame::write_JPEG_LS<RansCoders>(RansCoders &, const Slices &, int) const;
+template void Frame::write_JPEG_LS<CabacCoders>(CabacCoders &, const Slices &, int) const;
+template Frame Frame::decode_JPEG_LS<Golomb>(Golomb &, const Header &);
+template Frame Frame::decode_JPEG_LS<Rice>(Rice &, const Header &);
+template Frame Frame::decode_JPEG_LS<SpeculativeGolomb>(SpeculativeGolomb &, const Header &);
+template Frame Frame::decode_intra_blocks<Golomb>(Golomb &, BitStream &, const Header &);
+template Frame Frame::decode_intra_blocks<Rice>(Rice &, BitStream &, const Header &);
+template Frame Frame::decode_intra_blocks<SpeculativeGolomb>(SpeculativeGolomb &, BitStream &, const Header &);
+template Frame Frame::decode_intra<GolombCoders<Golomb>>(GolombCoders<Golomb> &, const Header &);
+template Frame Frame::decode_intra<GolombCoders<Rice>>(GolombCoders<Rice> &, const Header &);
+template Frame Frame::decode_intra<RansCoders>(RansCoders &, const Header &);
+template Frame Frame::decode_intra<CabacCoders>(CabacCoders &, const Header &);
+template void Frame::decode_intra<GolombCoders<Golomb>>(GolombCoders<Golomb> &, Mat &, int, int, bool);
+template void Frame::decode_intra<GolombCoders<Rice>>(GolombCoders<Rice> &, Mat &, int, int, bool);
+template void Frame::decode_intra<RansCoders>(RansCoders &, Mat &, int, int, bool);
+template void Frame::decode_intra<CabacCoders>(CabacCoders &, Mat &, int, int, bool);
+template void Frame::decode_temporal<GolombCoders<Golomb>>(GolombCoders<Golomb> &, Mat &, const Mat &, int, int, bool);
+template void Frame::decode_temporal<GolombCoders<Rice>>(GolombCoders<Rice> &, Mat &, const Mat &, int, int, bool);
+template void Frame::decode_temporal<RansCoders>(RansCoders &, Mat &, const Mat &, int, int, bool);
+template void Frame::decode_temporal<CabacCoders>(CabacCoders &, Mat &, const Mat &, int, int, bool);
+template void Frame::write<GolombCoders<Golomb>>(GolombCoders<Golomb> &) const;
+template void Frame::write<GolombCoders<Rice>>(GolombCoders<Rice> &) const;
+template void Frame::write<RansCoders>(RansCoders &) const;
+template void Frame::write<CabacCoders>(CabacCoders &) const;
+template void Frame::write<GolombCoders<Golomb>>(GolombCoders<Golomb> &, size_t, size_t) const;
+template void Frame::write<GolombCoders<Rice>>(GolombCoders<Rice> &, size_t, size_t) const;
+template void Frame::write<RansCoders>(RansCoders &, size_t, size_t) const;
+template void Frame::write<CabacCoders>(CabacCoders &, size_t, size_t) const;
+template Frame Frame::decode_inter<GolombCoders<Golomb>>(GolombCoders<Golomb> &, Frame &, const InterHeader &);
+template Frame Frame::decode_inter<GolombCoders<Rice>>(GolombCoders<Rice> &, Frame &, const InterHeader &);
+template Frame Frame::decode_inter<RansCoders>(RansCoders &, Frame &, const InterHeader &);
+template Frame Frame::decode_inter<CabacCoders>(CabacCoders &, Frame &, const InterHeader &);
+template void Frame::decode_inter<GolombCoders<Golomb>>(GolombCoders<Golomb> &, const InterHeader &, vector<MotionVector> &, size_t, size_t);
+template void Frame::decode_inter<GolombCoders<Rice>>(GolombCoders<Rice> &, const InterHeader &, vector<MotionVector> &, size_t, size_t);
+template void Frame::decode_inter<RansCoders>(RansCoders &, const InterHeader &, vector<MotionVector> &, size_t, size_t);
+template void Frame::decode_inter<CabacCoders>(CabacCoders &, const InterHeader &, vector<MotionVector> &, size_t, size_t);
@@ -7,6 +7,7 @@
 
 #include "../visual/Image.hpp"
 #include "Header.hpp"
+#include "EntropyCoder.hpp"
 #include <opencv2/core/mat.hpp>
 
 //! @brief The MotionVector struct represents a motion vector and its residual
@@ -188,6 +189,7 @@ class Frame {
     Block::BlockDiff *block_diff_{};          //!< Block difference method
     std::vector<MotionVector> motion_vectors_;//!< Vector of motion vectors
     std::vector<int> intra_encoding;          //!< Vector of intra encoding values
+    bool color_transform_{};                  //!< Whether the residuals are coded in YCoCg-R, see forward_ycocg
 
 public:
     /**
@@ -243,6 +245,11 @@ public:
      * \brief Sets the type of frame
      */
     void setType(FrameType type);
+    /**
+     * \brief Sets whether the residuals of the frame are coded in YCoCg-R
+     * \details Only BGR frames use it, and it must be set before the frame is encoded
+     */
+    void set_color_transform(bool color_transform);
     /**
      * \brief Displays the frame in a window
      */
@@ -250,16 +257,163 @@ public:
 
     void encode_JPEG_LS();
 
-    void encode_JPEG_LS(const Golomb &g);
+    //! Encodes the frame using JPEG-LS prediction, predicting every tile as if it were a frame of its own
+    //! @param slices slices and tiles of the frame
+    void encode_JPEG_LS(const Slices &slices);
+
+    //! Encodes the frame using JPEG-LS prediction, writing the residuals straight away
+    //! @tparam Coder Golomb or Rice
+    //! @param g reference to the golomb encoder
+    template<typename Coder>
+    void encode_JPEG_LS(const Coder &g);
+
+    //! Encodes the frame using JPEG-LS prediction, each row into a Golomb substream of its own (see Substreams)
+    //! @details The rows can then be decoded in a wavefront by decode_JPEG_LS_rows
+    //! @param bs BitStream to write to
+    //! @param m the Golomb m parameter
+    //! @param golomb_limit quotient limit of the golomb code, 0 for unlimited codes
+    void encode_JPEG_LS_rows(BitStream &bs, int m, int golomb_limit);
+
+    //! Encodes the frame predicting every sample from its neighbours and from the previous frame (see TemporalKernel)
+    //! @details The frame becomes a P frame without motion vectors, and its residuals are kept as its intra encoding.
+    //! Every tile is predicted as if it were a frame of its own
+    //! @param reference previous frame, as the decoder rebuilds it
+    //! @param slices slices and tiles of the frame
+    void encode_temporal(const Frame &reference, const Slices &slices);
+
+    //! Picks the intra predictor of every block, the one whose residuals have the smallest sum of absolute values
+    //! @details Blocks are PREDICTOR_BLOCK pixels wide and high, the ones at the right and bottom edges may be smaller
+    //! @return predictor of every block, row by row
+    std::vector<uint8_t> select_predictors() const;
+
+    //! Encodes the frame predicting every block with the intra predictor that suits it best (see select_predictors)
+    //! @details The predictors are written first, with INTRA_PREDICTOR_BITS bits each, then the residuals as
+    //! encode_JPEG_LS writes them
+    //! @tparam Coder Golomb or Rice
+    //! @param g reference to the golomb encoder
+    //! @param bs BitStream the encoder writes to
+    template<typename Coder>
+    void encode_intra_blocks(const Coder &g, BitStream &bs);
+
+    //! Writes the intra encoding values, each channel with its own coder
+    //! @details Every row is written channel by channel
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the encoders
+    template<typename Coders>
+    void write_JPEG_LS(Coders &g) const;
+
+    //! Writes the intra encoding values of a tile, each channel with its own coder
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the encoders
+    //! @param slices slices and tiles of the frame
+    //! @param tile the tile to write
+    template<typename Coders>
+    void write_JPEG_LS(Coders &g, const Slices &slices, int tile) const;
+
+    //! Writes the frame into a private BitStream with coders of its own
+    //! @details Intra frames write their intra encoding, inter frames their motion vectors, and frames encoded by
+    //! encode_temporal their residuals with the inter coders. Frames written this way can
+    //! be encoded in parallel and joined with BitStream::append
+    //! @param bs in-memory BitStream to write to
+    //! @param coder entropy coder to use
+    //! @param parameters golomb m of each class of syntax element, for the Golomb coder
+    //! @param golomb_limit quotient limit of the golomb code, 0 for unlimited codes
+    void write_frame(BitStream &bs, ENTROPY_CODER coder, const GolombParameters &parameters, int golomb_limit) const;
+
+    //! Writes the frame tile by tile, each tile with coders of its own (see writeSlices)
+    //! @details Tiles of inter frames are made of whole blocks, so the unit of the slices must be the block size
+    //! @param bs in-memory BitStream to write to
+    //! @param coder entropy coder to use
+    //! @param parameters golomb m of each class of syntax element, for the Golomb coder
+    //! @param golomb_limit quotient limit of the golomb code, 0 for unlimited codes
+    //! @param slices slices and tiles of the frame, which must match the ones it was predicted with
+    void write_frame(BitStream &bs, ENTROPY_CODER coder, const GolombParameters &parameters, int golomb_limit,
+                     const Slices &slices) const;
+
+    //! Reads a frame written by write_frame, its tiles on several threads
+    //! @param bs BitStream to read from
+    //! @param header header data, with the entropy coder and its parameters, and the block size of inter frames
+    //! @param slices slices and tiles of the frame
+    //! @param reference frame that serves as reference, nullptr for an intra frame. With a temporal header it must be
+    //! the previous frame
+    //! @return decoded frame
+    static Frame read_frame(BitStream &bs, const InterHeader &header, const Slices &slices, Frame *reference);
 
-    void write_JPEG_LS(const Golomb &g) const;
+    //! Decodes a frame encoded using JPEG-LS prediction
+    //! @tparam Coder Golomb or Rice
+    //! @param g reference to the golomb decoder
+    //! @param header header data
+    //! @return decoded frame
+    template<typename Coder>
+    static Frame decode_JPEG_LS(Coder &g, const Header &header);
 
-    static Frame decode_JPEG_LS(Golomb &g, const Header &header);
+    //! Decodes a frame written by encode_JPEG_LS_rows, its rows on several threads (see Wavefront)
+    //! @param bs BitStream to read from
+    //! @param header header data, with the Golomb m and limit
+    //! @return decoded frame
+    static Frame decode_JPEG_LS_rows(BitStream &bs, const Header &header);
 
-    static Frame decode_JPEG_LS(const std::vector<int> &encodings, COLOR_SPACE color, CHROMA_SUBSAMPLING cs_ratio, int rows, int cols);
+    //! Decodes a frame written by encode_intra_blocks
+    //! @tparam Coder Golomb, Rice or SpeculativeGolomb
+    //! @param g reference to the golomb decoder
+    //! @param bs BitStream the decoder reads from
+    //! @param header header data
+    //! @return decoded frame
+    template<typename Coder>
+    static Frame decode_intra_blocks(Coder &g, BitStream &bs, const Header &header);
 
+    //! Decodes a frame written by write_JPEG_LS with a coder per channel
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the decoders
+    //! @param header header data
+    //! @return decoded frame
+    template<typename Coders>
+    static Frame decode_intra(Coders &g, const Header &header);
+
+    //! Decodes some rows written by write_JPEG_LS, predicting the first of them as the first row of a frame
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the decoders
+    //! @param mat frame being decoded, with one or three channels, or the columns of a tile of it
+    //! @param begin first row to decode
+    //! @param end row after the last one to decode
+    //! @param color_transform whether the residuals were coded in YCoCg-R
+    template<typename Coders>
+    static void decode_intra(Coders &g, cv::Mat &mat, int begin, int end, bool color_transform);
+
+    //! Decodes some rows of a frame encoded by encode_temporal, predicting the first of them as the first row of a frame
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the decoders
+    //! @param mat frame being decoded, with one or three channels, or the columns of a tile of it
+    //! @param reference previous frame, with as many channels, or the same columns of it
+    //! @param begin first row to decode
+    //! @param end row after the last one to decode
+    //! @param color_transform whether the residuals were coded in YCoCg-R
+    template<typename Coders>
+    static void decode_temporal(Coders &g, cv::Mat &mat, const cv::Mat &reference, int begin, int end,
+                                bool color_transform);
+
+    static Frame decode_JPEG_LS(const std::vector<int> &encodings, COLOR_SPACE color, CHROMA_SUBSAMPLING cs_ratio, int rows, int cols, bool color_transform = false);
+
+    //! Predicts a single sample with the JPEG-LS median edge detector
+    //! @details Whole rows are better predicted with MedKernel, which this wraps
+    //! @param mat frame, with one or three channels
+    //! @param row row of the sample
+    //! @param col column of the sample
+    //! @param channel channel of the sample
+    //! @return the prediction
     static uchar predict_JPEG_LS(cv::Mat &mat, int row, int col, int channel = 0);
 
+    //! Encodes the frame with LOCO-I context modelling, adapting the Golomb parameter to every pixel
+    //! @details The frame is coded on its own, so frames can be written to separate BitStreams in parallel
+    //! @param bs BitStream to write to
+    void encode_LOCO_I(BitStream &bs);
+
+    //! Decodes a frame encoded with encode_LOCO_I
+    //! @param bs BitStream to read from
+    //! @param header header data
+    //! @return decoded frame
+    static Frame decode_LOCO_I(BitStream &bs, const Header &header);
+
     //! Returns a valid search window
     //! @param block Block that is being compared (top-left corner)
     //! @param search_radius Radius of the search area (around the block itself)
@@ -300,14 +454,44 @@ public:
     //! @return Reconstructed frame
     Frame static reconstruct_frame(Frame &reference, const std::vector<MotionVector> &motion_vectors, int block_size);
 
-    //! Write the motions vectors of a frame to file using golomb encoding
-    //! @param g reference to the Golomb encoder
-    void write(const Golomb &g) const;
+    //! Write the motions vectors of a frame to file
+    //! @details Each block is written as its motion vector followed by its residual, channel by channel, and every
+    //! syntax element uses its own coder
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the encoders
+    template<typename Coders>
+    void write(Coders &g) const;
+
+    //! Gets the residual of a block as write codes it, in YCoCg-R if the frame's residuals are coded that way
+    //! @param mv motion vector of the block
+    //! @param pixels where the samples are stored, the channels of every pixel one after the other
+    void coded_residual(const MotionVector &mv, std::vector<int> &pixels) const;
+
+    //! Write the motion vectors of some blocks to file
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the encoders
+    //! @param begin index of the first block to write
+    //! @param end index of the block after the last one to write
+    template<typename Coders>
+    void write(Coders &g, size_t begin, size_t end) const;
 
     //! Decodes a frame using interframe codec
-    //! @param g refernece to the golomb encoder
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g refernece to the decoders
     //! @param reference intraframe that serves as reference
     //! @param header header data
     //! @return decoded frame
-    static Frame decode_inter(Golomb &g, Frame &reference, const InterHeader &header);
+    template<typename Coders>
+    static Frame decode_inter(Coders &g, Frame &reference, const InterHeader &header);
+
+    //! Decodes the motion vectors of some blocks
+    //! @tparam Coders an EntropyCoder policy, see withEntropyCoders
+    //! @param g reference to the decoders
+    //! @param header header data
+    //! @param mvs motion vectors of the frame, the ones of the blocks are stored in place
+    //! @param begin index of the first block to decode
+    //! @param end index of the block after the last one to decode
+    template<typename Coders>
+    static void decode_inter(Coders &g, const InterHeader &header, std::vector<MotionVector> &mvs, size_t begin,
+                             size_t end);
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "GolombParameters.hpp"
+#include "Frame.hpp"
+
+using namespace std;
+using namespace cv;
+
+GolombParameters GolombParameters::uniform(const int m) {
+    GolombParameters parameters;
+    parameters.mv_x = m;
+    parameters.mv_y = m;
+    parameters.inter.fill(m);
+    parameters.intra.fill(m);
+    return parameters;
+}
+
+bool GolombParameters::rice() const {
+    bool fits = Rice::fits(mv_x) && Rice::fits(mv_y);
+    for (int channel = 0; channel < 3; channel++) {
+        fits = fits && Rice::fits(inter[channel]) && Rice::fits(intra[channel]);
+    }
+    return fits;
+}
+
+void GolombParameters::write(BitStream &bs) const {
+    bs.writeBits(mv_x, 8);
+    bs.writeBits(mv_y, 8);
+    for (const uint8_t m: inter) { bs.writeBits(m, 8); }
+    for (const uint8_t m: intra) { bs.writeBits(m, 8); }
+}
+
+GolombParameters GolombParameters::read(BitStream &bs) {
+    GolombParameters parameters;
+    parameters.mv_x = bs.readBits(8);
+    parameters.mv_y = bs.readBits(8);
+    for (uint8_t &m: parameters.inter) { m = bs.readBits(8); }
+    for (uint8_t &m: parameters.intra) { m = bs.readBits(8); }
+    return parameters;
+}
+
+void GolombStatistics::add_inter(const Frame &frame) {
+    // The residuals are counted as they are coded, so YCoCg-R channels get parameters of their own
+    vector<int> pixels;
+    for (const auto &mv: frame.get_motion_vectors()) {
+        mv_x.add(mv.x);
+        mv_y.add(mv.y);
+        frame.coded_residual(mv, pixels);
+        const int channels = mv.residual.channels();
+        for (size_t i = 0; i < pixels.size(); i++) { inter[i % channels].add(pixels[i]); }
+    }
+}
+
+void GolombStatistics::add_intra(const vector<int> &encoding, const int channels) {
+    for (size_t i = 0; i < encoding.size(); i++) { intra[i % channels].add(encoding[i]); }
+}
+
+void GolombStatistics::add_temporal(const vector<int> &encoding, const int channels) {
+    for (size_t i = 0; i < encoding.size(); i++) { inter[i % channels].add(encoding[i]); }
+}
+
+void GolombStatistics::merge(const GolombStatistics &other) {
+    mv_x.merge(other.mv_x);
+    mv_y.merge(other.mv_y);
+    for (int channel = 0; channel < 3; channel++) {
+        inter[channel].merge(other.inter[channel]);
+        intra[channel].merge(other.intra[channel]);
+    }
+}
+
+GolombParameters GolombStatistics::parameters() const {
+    GolombParameters parameters;
+    parameters.mv_x = mv_x.best_m();
+    parameters.mv_y = mv_y.best_m();
+    for (int channel = 0; channel < 3; channel++) {
+        parameters.inter[channel] = inter[channel].best_m();
+        parameters.intra[channel] = intra[channel].best_m();
+    }
+    return parameters;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file GolombParameters.hpp
+ * @brief GolombParameters struct
+ * @ingroup Codec
+ * Declares the Golomb parameters of each class of syntax element of inter and hybrid streams, how they are estimated
+ * and the set of coders built from them.
+ */
+
+#pragma once
+#include "../io/GolombEstimator.hpp"
+#include "../io/Rice.hpp"
+#include <array>
+#include <utility>
+#include <vector>
+
+class Frame;
+
+/**
+ * \brief Golomb m parameters of each class of syntax element
+ * \details Motion vector components are small while residuals are large, and each channel has residuals of its own
+ * magnitude, so every class gets the m that suits it.
+ */
+struct GolombParameters {
+    uint8_t mv_x = 1;                       //!< m of the horizontal motion vector components
+    uint8_t mv_y = 1;                       //!< m of the vertical motion vector components
+    std::array<uint8_t, 3> inter{{1, 1, 1}};//!< m of the inter residuals of each channel
+    std::array<uint8_t, 3> intra{{1, 1, 1}};//!< m of the intra residuals of each channel
+
+    /**
+     * \brief Builds parameters that use the same m for every syntax element
+     * \param m the m parameter
+     * \return the parameters
+     */
+    static GolombParameters uniform(int m);
+    /**
+     * \brief Whether every m is a power of two, so that Rice coders can be used
+     */
+    bool rice() const;
+    /**
+     * \brief Writes the parameters to BitStream
+     * \param bs BitStream reference
+     */
+    void write(BitStream &bs) const;
+    /**
+     * \brief Reads the parameters from BitStream
+     * \param bs BitStream reference
+     * \return the parameters
+     */
+    static GolombParameters read(BitStream &bs);
+};
+
+/**
+ * \brief Gathers the statistics of each class of syntax element, to pick the GolombParameters that code them best
+ */
+struct GolombStatistics {
+    GolombEstimator mv_x;                 //!< horizontal motion vector components
+    GolombEstimator mv_y;                 //!< vertical motion vector components
+    std::array<GolombEstimator, 3> inter; //!< inter residuals of each channel
+    std::array<GolombEstimator, 3> intra; //!< intra residuals of each channel
+
+    /**
+     * \brief Adds the motion vectors and residuals of an inter frame, as Frame::write codes them
+     * \param frame frame whose motion vectors were calculated
+     */
+    void add_inter(const Frame &frame);
+    /**
+     * \brief Adds the intra residuals of a frame
+     * \param encoding residuals, with the channels of each pixel interleaved
+     * \param channels number of channels
+     */
+    void add_intra(const std::vector<int> &encoding, int channels);
+    /**
+     * \brief Adds the residuals of a frame predicted from the previous one, which are coded as inter residuals
+     * \param encoding residuals, with the channels of each pixel interleaved
+     * \param channels number of channels
+     */
+    void add_temporal(const std::vector<int> &encoding, int channels);
+    /**
+     * \brief Adds the values seen by other statistics
+     * \param other the other statistics
+     */
+    void merge(const GolombStatistics &other);
+    /**
+     * \brief Picks the best m of every class of syntax element
+     * \return the parameters
+     */
+    GolombParameters parameters() const;
+};
+
+/**
+ * \brief A golomb coder for each class of syntax element, all sharing the same BitStream
+ * \tparam Coder Golomb or Rice
+ */
+template<typename Coder>
+struct GolombCoders {
+    Coder mv_x;                //!< horizontal motion vector components
+    Coder mv_y;                //!< vertical motion vector components
+    std::array<Coder, 3> inter;//!< inter residuals of each channel
+    std::array<Coder, 3> intra;//!< intra residuals of each channel
+
+    /**
+     * \brief Constructor
+     * \param bs BitStream object to use
+     * \param parameters m of each class of syntax element
+     * \param limit quotient limit of the codes, 0 for unlimited codes
+     */
+    GolombCoders(BitStream *bs, const GolombParameters &parameters, const int limit)
+        : mv_x(bs), mv_y(bs), inter{{Coder(bs), Coder(bs), Coder(bs)}}, intra{{Coder(bs), Coder(bs), Coder(bs)}} {
+        auto setup = [limit](Coder &coder, const int m) {
+            coder.set_limit(limit);
+            coder.set_m(m);
+        };
+        setup(mv_x, parameters.mv_x);
+        setup(mv_y, parameters.mv_y);
+        for (int channel = 0; channel < 3; channel++) {
+            setup(inter[channel], parameters.inter[channel]);
+            setup(intra[channel], parameters.intra[channel]);
+        }
+    }
+
+    /**
+     * \brief Starts decoding a frame, the codes are read as they are needed so there is nothing to load
+     */
+    void begin_frame(BitStream &) {}
+    /**
+     * \brief Ends encoding a frame, the codes are written as they are made so there is nothing to write
+     */
+    void end_frame(BitStream &) {}
+};
+
+/**
+ * \brief Runs f with the fastest set of golomb coders for the parameters
+ * \details Rice coders are used if every m is a power of two, Golomb coders otherwise
+ * \param bs BitStream object to use
+ * \param parameters m of each class of syntax element
+ * \param limit quotient limit of the codes, 0 for unlimited codes
+ * \param f generic callable, called with GolombCoders of Rice or Golomb
+ */
+template<typename F>
+void withGolombCoders(BitStream *bs, const GolombParameters &parameters, const int limit, F &&f) {
+    if (parameters.rice()) {
+        GolombCoders<Rice> coders(bs, parameters, limit);
+        std::forward<F>(f)(coders);
+    } else {
+        GolombCoders<Golomb> coders(bs, parameters, limit);
+        std::forward<F>(f)(coders);
+    }
+}
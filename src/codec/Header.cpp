@@ -3,7 +3,7 @@
 #include "Frame.hpp"
 
 Header::Header(const COLOR_SPACE color_space, const CHROMA_SUBSAMPLING cs, const uint8_t width, const uint8_t height)
-    : golomb_m(0), length(0), fps_num(0), fps_den(0) {
+    : golomb_m(0), golomb_limit(0), entropy_coder(GOLOMB), wavefront(0), slices(1), tiles(1), block_predictors(0), color_transform(0), temporal(0), length(0), fps_num(0), fps_den(0) {
     this->color_space = color_space;
     this->chroma_subsampling = cs;
     this->width = width;
@@ -15,6 +15,14 @@ void Header::write_header(BitStream &bs) const {
     bs.writeBits(static_cast<int>(width), 32);
     bs.writeBits(static_cast<int>(height), 32);
     bs.writeBits(golomb_m, 8);
+    bs.writeBits(golomb_limit, 8);
+    bs.writeBits(entropy_coder, 8);
+    bs.writeBits(wavefront, 8);
+    bs.writeBits(slices, 8);
+    bs.writeBits(tiles, 8);
+    bs.writeBits(block_predictors, 8);
+    bs.writeBits(color_transform, 8);
+    bs.writeBits(temporal, 8);
     bs.writeBits(static_cast<int>(length), 32);
     bs.writeBits(fps_num, 8);
     bs.writeBits(fps_den, 8);
@@ -32,33 +40,30 @@ Header Header::read_header(BitStream &bs) {
     header.width = bs.readBits(32);
     header.height = bs.readBits(32);
     header.golomb_m = bs.readBits(8);
+    header.golomb_limit = bs.readBits(8);
+    header.entropy_coder = static_cast<ENTROPY_CODER>(bs.readBits(8));
+    header.wavefront = bs.readBits(8);
+    header.slices = bs.readBits(8);
+    header.tiles = bs.readBits(8);
+    header.block_predictors = bs.readBits(8);
+    header.color_transform = bs.readBits(8);
+    header.temporal = bs.readBits(8);
     header.length = bs.readBits(32);
     header.fps_num = bs.readBits(8);
     header.fps_den = bs.readBits(8);
     return header;
 }
 
-InterHeader::InterHeader(const Header &header) : Header(), block_size(0) {
-    this->color_space = header.color_space;
-    this->chroma_subsampling = header.chroma_subsampling;
-    this->height = header.height;
-    this->width = header.width;
-    this->golomb_m = header.golomb_m;
-    this->length = header.length;
-}
+InterHeader::InterHeader(const Header &header) : Header(header), block_size(0) {}
 void InterHeader::write_header(BitStream &bs) const {
     Header::write_header(bs);
     bs.writeBits(block_size, 8);
+    golomb_parameters.write(bs);
 }
 
 InterHeader InterHeader::read_header(BitStream &bs) {
-    InterHeader header{};
-    header.color_space = static_cast<COLOR_SPACE>(bs.readBits(3));
-    header.chroma_subsampling = static_cast<CHROMA_SUBSAMPLING>(bs.readBits(3));
-    header.width = bs.readBits(32);
-    header.height = bs.readBits(32);
-    header.golomb_m = bs.readBits(8);
-    header.length = bs.readBits(32);
+    InterHeader header(Header::read_header(bs));
     header.block_size = bs.readBits(8);
+    header.golomb_parameters = GolombParameters::read(bs);
     return header;
 }
\ No newline at end of file
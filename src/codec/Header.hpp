@@ -8,9 +8,19 @@
 #pragma once
 #include "../visual/Image.hpp"
 #include "../visual/YuvHeader.hpp"
+#include "GolombParameters.hpp"
 
 class Frame;
 
+/**
+ * \brief Entropy coder of the residuals of a stream
+ */
+enum ENTROPY_CODER : std::uint8_t {
+    GOLOMB,//!< Golomb-Rice codes
+    RANS,  //!< Static rANS, with frequency tables sent with every frame
+    CABAC  //!< Context-adaptive binary arithmetic coding
+};
+
 /**
  * \brief The Header class defines the basic header structure for the codec
  */
@@ -21,6 +31,14 @@ public:
     uint32_t width;                       //!< Width
     uint32_t height;                      //!< Height
     uint8_t golomb_m;                     //!< Golomb m parameter
+    uint8_t golomb_limit;                 //!< Golomb quotient limit, 0 if codes aren't length-limited
+    ENTROPY_CODER entropy_coder;          //!< Entropy coder of the residuals
+    uint8_t wavefront;                    //!< Whether intra frames have a substream per row, see Wavefront
+    uint8_t slices;                       //!< Number of slices of every frame, see Slices
+    uint8_t tiles;                        //!< Number of tiles of every slice, see Slices
+    uint8_t block_predictors;             //!< Whether intra frames pick a predictor for every block, see INTRA_PREDICTOR
+    uint8_t color_transform;              //!< Whether the residuals of BGR frames are coded in YCoCg-R, see forward_ycocg
+    uint8_t temporal;                     //!< Whether inter frames are predicted sample by sample, see TemporalKernel
     uint32_t length;                      //!< Number of frames
     uint8_t fps_num;                      //!< FPS numerator
     uint8_t fps_den;                      //!< FPS denominator
@@ -57,7 +75,8 @@ public:
 
 class InterHeader : public Header {
 public:
-    uint8_t block_size;//!< Block size
+    uint8_t block_size;                //!< Block size
+    GolombParameters golomb_parameters;//!< Golomb m of each class of syntax element
     /**
      * \brief Default constructor
      */
@@ -0,0 +1,195 @@
+/**
+ * @file IntraPredictor.hpp
+ * @brief IntraPredictor kernels
+ * @ingroup Codec
+ * Declares the intra predictors a block of a lossless intra frame can pick from, and their row kernels.
+ */
+
+#pragma once
+#include "MedKernel.hpp"
+#include <cstdlib>
+
+/**
+ * \brief Intra predictors, one of which is picked for every block of a frame
+ * \details a, b, c and d are the left, upper, upper left and upper right neighbours of the sample
+ */
+enum INTRA_PREDICTOR {
+    PREDICT_MED,        //!< Median edge detector of JPEG-LS, med(a, b, c)
+    PREDICT_LEFT,       //!< a, for horizontal structures
+    PREDICT_ABOVE,      //!< b, for vertical structures
+    PREDICT_ABOVE_LEFT, //!< c, for structures running down to the right
+    PREDICT_ABOVE_RIGHT,//!< (b + d) / 2, for structures running down to the left
+    PREDICT_PLANAR,     //!< a + b - c, for smooth gradients
+    PREDICT_AVERAGE,    //!< (a + b) / 2, for noisy regions
+    PREDICT_GAP         //!< Gradient adjusted prediction of CALIC, from a, b, c and d only
+};
+
+constexpr int INTRA_PREDICTORS = 8;    //!< Number of intra predictors
+constexpr int INTRA_PREDICTOR_BITS = 3;//!< Bits the predictor of a block is written with
+constexpr int PREDICTOR_BLOCK = 16;    //!< Width and height of the blocks that pick their predictor
+
+/**
+ * \brief Gradient adjusted prediction of CALIC
+ * \details CALIC estimates the gradients from seven neighbours; only the ones the kernels have at hand are used here, so
+ * the horizontal gradient is taken along the row above and the vertical one at the left neighbour
+ * \param a left neighbour
+ * \param b upper neighbour
+ * \param c upper left neighbour
+ * \param d upper right neighbour
+ * \return the prediction
+ */
+inline int gap(const int a, const int b, const int c, const int d) {
+    const int dh = std::abs(c - b) + std::abs(b - d);
+    const int dv = 2 * std::abs(a - c);
+    // A sharp edge is predicted along it
+    if (dv - dh > 80) { return a; }
+    if (dh - dv > 80) { return b; }
+    int prediction = (a + b) / 2 + (d - c) / 4;
+    if (dv - dh > 32) {
+        prediction = (prediction + a) / 2;
+    } else if (dv - dh > 8) {
+        prediction = (3 * prediction + a) / 4;
+    } else if (dh - dv > 32) {
+        prediction = (prediction + b) / 2;
+    } else if (dh - dv > 8) {
+        prediction = (3 * prediction + b) / 4;
+    }
+    return std::min(std::max(prediction, 0), 255);
+}
+
+/**
+ * \brief Prediction of a sample with all of its neighbours
+ * \tparam Predictor the predictor
+ * \param a left neighbour
+ * \param b upper neighbour
+ * \param c upper left neighbour
+ * \param d upper right neighbour
+ * \return the prediction
+ */
+template<INTRA_PREDICTOR Predictor>
+int predict_intra(const int a, const int b, const int c, const int d) {
+    // Predictor is a constant, so only one case is compiled into each kernel
+    switch (Predictor) {
+        case PREDICT_MED:
+            return med(a, b, c);
+        case PREDICT_LEFT:
+            return a;
+        case PREDICT_ABOVE:
+            return b;
+        case PREDICT_ABOVE_LEFT:
+            return c;
+        case PREDICT_ABOVE_RIGHT:
+            return (b + d) / 2;
+        case PREDICT_PLANAR:
+            return std::min(std::max(a + b - c, 0), 255);
+        case PREDICT_AVERAGE:
+            return (a + b) / 2;
+        default:
+            return gap(a, b, c, d);
+    }
+}
+
+/**
+ * \brief Predicts the samples of a row with one of the intra predictors
+ * \details Samples are handled as by MedKernel: a sample of the first row is predicted by its left neighbour, one of
+ * the first column by its upper neighbour, and the first sample by 0. The last column has no upper right neighbour, so
+ * its upper neighbour is used in its place. With PREDICT_MED the residuals are the ones of MedKernel.
+ * \tparam Channels number of channels of the frame, 1 or 3
+ * \tparam Predictor the predictor
+ */
+template<int Channels, INTRA_PREDICTOR Predictor>
+struct PredictorKernel {
+    /**
+     * \brief Computes the residuals of some columns of a row whose samples are all known
+     * \param row first sample of the row
+     * \param above first sample of the row above, nullptr for the first row
+     * \param cols number of pixels of the row
+     * \param begin first column
+     * \param end column after the last one
+     * \param residuals residuals of the row, those of the columns are stored at the index of their sample
+     */
+    static void residuals(const uint8_t *row, const uint8_t *above, const int cols, const int begin, const int end,
+                          int *residuals) {
+        sweep(row, above, cols, begin, end, [row, residuals](const int i, const int predicted) {
+            residuals[i] = row[i] - predicted;
+        });
+    }
+
+    /**
+     * \brief Rebuilds some columns of a row, the ones before them being rebuilt already
+     * \param row first sample of the row, overwritten with the rebuilt samples
+     * \param above first sample of the row above, nullptr for the first row
+     * \param cols number of pixels of the row
+     * \param begin first column to rebuild
+     * \param end column after the last one to rebuild
+     * \param sample callable taking the index of a sample in the row and its prediction, and returning the sample
+     */
+    template<typename F>
+    static void reconstruct(uint8_t *row, const uint8_t *above, const int cols, const int begin, const int end,
+                            F &&sample) {
+        sweep(row, above, cols, begin, end, [row, &sample](const int i, const int predicted) {
+            row[i] = sample(i, predicted);
+        });
+    }
+
+private:
+    //! Calls f with the index and the prediction of every sample of the columns, in order
+    template<typename Row, typename F>
+    static void sweep(Row *row, const uint8_t *above, const int cols, const int begin, const int end, F &&f) {
+        int i = begin * Channels;
+        const int n = end * Channels;
+        if (begin == 0) {
+            for (; i < std::min(n, Channels); i++) { f(i, above == nullptr ? 0 : above[i]); }
+        }
+        if (above == nullptr) {
+            for (; i < n; i++) { f(i, row[i - Channels]); }
+            return;
+        }
+        // The last column is left out of the loop, so that every sample of the loop has an upper right neighbour
+        const int inner = std::min(n, (cols - 1) * Channels);
+        for (; i < inner; i++) {
+            f(i, predict_intra<Predictor>(row[i - Channels], above[i], above[i - Channels], above[i + Channels]));
+        }
+        for (; i < n; i++) {
+            f(i, predict_intra<Predictor>(row[i - Channels], above[i], above[i - Channels], above[i]));
+        }
+    }
+};
+
+/**
+ * \brief Calls a function with the kernel of a channel count and a predictor
+ * \param channels 1 or 3
+ * \param predictor the predictor
+ * \param f generic callable, called with a PredictorKernel
+ */
+template<typename F>
+void withPredictorKernel(const int channels, const INTRA_PREDICTOR predictor, F &&f) {
+    withMedKernel(channels, [predictor, &f](auto med_kernel) {
+        constexpr int count = decltype(med_kernel)::CHANNELS;
+        switch (predictor) {
+            case PREDICT_MED:
+                f(PredictorKernel<count, PREDICT_MED>());
+                break;
+            case PREDICT_LEFT:
+                f(PredictorKernel<count, PREDICT_LEFT>());
+                break;
+            case PREDICT_ABOVE:
+                f(PredictorKernel<count, PREDICT_ABOVE>());
+                break;
+            case PREDICT_ABOVE_LEFT:
+                f(PredictorKernel<count, PREDICT_ABOVE_LEFT>());
+                break;
+            case PREDICT_ABOVE_RIGHT:
+                f(PredictorKernel<count, PREDICT_ABOVE_RIGHT>());
+                break;
+            case PREDICT_PLANAR:
+                f(PredictorKernel<count, PREDICT_PLANAR>());
+                break;
+            case PREDICT_AVERAGE:
+                f(PredictorKernel<count, PREDICT_AVERAGE>());
+                break;
+            default:
+                f(PredictorKernel<count, PREDICT_GAP>());
+        }
+    });
+}
@@ -0,0 +1,254 @@
+#include "LocoI.hpp"
+#include "../io/Golomb.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+    // Gradient thresholds for 8-bit samples
+    constexpr int T1 = 3;
+    constexpr int T2 = 7;
+    constexpr int T3 = 21;
+    constexpr int RANGE = 256;
+
+    int quantize_gradient(const int d) {
+        if (d <= -T3) return -4;
+        if (d <= -T2) return -3;
+        if (d <= -T1) return -2;
+        if (d < 0) return -1;
+        if (d == 0) return 0;
+        if (d < T1) return 1;
+        if (d < T2) return 2;
+        if (d < T3) return 3;
+        return 4;
+    }
+
+    // Quantized gradients of every difference between two samples, indexed by difference + 255
+    struct GradientTable {
+        int8_t q[2 * RANGE - 1];
+        GradientTable() : q() {
+            for (int d = -(RANGE - 1); d < RANGE; d++) { q[d + RANGE - 1] = static_cast<int8_t>(quantize_gradient(d)); }
+        }
+    };
+    const GradientTable gradients;
+}// namespace
+
+LocoI::LocoI(const int channels) : channels(channels), states(channels) { reset(); }
+
+void LocoI::reset() {
+    const int a = max(2, (RANGE + 32) / 64);
+    for (auto &state: states) {
+        state.contexts.fill({a, 0, 0, 1});
+        state.run_contexts.fill({a, 1, 0});
+        state.run = RunMode();
+    }
+}
+
+int LocoI::context_index(const int a, const int b, const int c, const int d, int &sign) {
+    const int q1 = gradients.q[d - b + RANGE - 1];
+    const int q2 = gradients.q[b - c + RANGE - 1];
+    const int q3 = gradients.q[c - a + RANGE - 1];
+    // Contexts with opposite gradients are merged, and their errors negated
+    const int index = (q1 * 9 + q2) * 9 + q3;
+    sign = index < 0 ? -1 : 1;
+    return abs(index);
+}
+
+int LocoI::predict(const int a, const int b, const int c) {
+    if (c >= max(a, b)) return min(a, b);
+    if (c <= min(a, b)) return max(a, b);
+    return a + b - c;
+}
+
+int LocoI::k_parameter(const Context &context) {
+    int k = 0;
+    while ((context.N << k) < context.A) { k++; }
+    return k;
+}
+
+void LocoI::update(Context &context, const int error) {
+    context.B += error;
+    context.A += abs(error);
+    if (context.N == RESET) {
+        context.A >>= 1;
+        context.B = context.B >= 0 ? context.B >> 1 : -((1 - context.B) >> 1);
+        context.N >>= 1;
+    }
+    context.N++;
+    // The bias correction moves by one whenever the average error leaves [-1, 0]
+    if (context.B <= -context.N) {
+        context.B += context.N;
+        if (context.C > -128) { context.C--; }
+        if (context.B <= -context.N) { context.B = -context.N + 1; }
+    } else if (context.B > 0) {
+        context.B -= context.N;
+        if (context.C < 127) { context.C++; }
+        if (context.B > 0) { context.B = 0; }
+    }
+}
+
+int LocoI::k_parameter(const RunContext &context, const bool same) {
+    const int a = same ? context.A + (context.N >> 1) : context.A;
+    int k = 0;
+    while ((context.N << k) < a) { k++; }
+    return k;
+}
+
+void LocoI::update(RunContext &context, const int error, const int mapped, const bool same) {
+    if (error < 0) { context.Nn++; }
+    context.A += (mapped + 1 - static_cast<int>(same)) >> 1;
+    if (context.N == RESET) {
+        context.A >>= 1;
+        context.N >>= 1;
+        context.Nn >>= 1;
+    }
+    context.N++;
+}
+
+void LocoI::write_code(BitStream &bs, const int value, const int k) {
+    const int q = value >> k;
+    if (q < LIMIT - QBPP - 1) {
+        bs.writeBits(((uint64_t{1} << q) - 1) << (k + 1) | (value & ((1 << k) - 1)), q + 1 + k);
+    } else {
+        // Escape: the longest run of ones, then the value in plain binary
+        bs.writeBits(((uint64_t{1} << (LIMIT - QBPP - 1)) - 1) << (QBPP + 1) | (value - 1), LIMIT);
+    }
+}
+
+int LocoI::read_code(BitStream &bs, const int k) {
+    // The low byte of the window is inverted to ones, which stops the count at the escape
+    const int q = countLeadingZeros(~static_cast<uint32_t>(bs.peekBits(LIMIT - QBPP) << QBPP));
+    if (q >= LIMIT - QBPP - 1) {
+        bs.skipBits(LIMIT - QBPP);
+        return static_cast<int>(bs.readBits(QBPP)) + 1;
+    }
+    bs.skipBits(q + 1);
+    return (q << k) | static_cast<int>(bs.readBits(k));
+}
+
+void LocoI::encode_line(BitStream &bs, Channel &state, const int *prev, const int *cur, const int cols) {
+    for (int i = 1; i <= cols; i++) {
+        const int a = cur[i - 1], b = prev[i], c = prev[i - 1], d = prev[i + 1];
+        int sign;
+        const int index = context_index(a, b, c, d, sign);
+        if (index == 0) {
+            // Flat neighbourhood, count the samples equal to the left one
+            int count = 0;
+            while (i + count <= cols && cur[i + count] == a) { count++; }
+            state.run.encode(bs, count, cols - i + 1);
+            i += count;
+            if (i > cols) { break; }
+            // The interrupting sample is predicted from its upper neighbour, or its left one if they are equal
+            const int above = prev[i];
+            const bool same = a == above;
+            RunContext &context = state.run_contexts[same];
+            int error = cur[i] - (same ? a : above);
+            if (!same && a > above) { error = -error; }
+            if (error < 0) { error += RANGE; }
+            if (error >= RANGE / 2) { error -= RANGE; }
+            const int k = k_parameter(context, same);
+            const bool map = (k == 0 && error > 0 && 2 * context.Nn < context.N) ||
+                             (error < 0 && (2 * context.Nn >= context.N || k != 0));
+            const int mapped = 2 * abs(error) - static_cast<int>(same) - static_cast<int>(map);
+            write_code(bs, mapped, k);
+            update(context, error, mapped, same);
+            continue;
+        }
+        Context &context = state.contexts[index];
+        const int predicted = min(max(predict(a, b, c) + sign * context.C, 0), RANGE - 1);
+        // The error is reduced modulo the range, so it always fits in QBPP bits once mapped
+        int error = sign * (cur[i] - predicted);
+        if (error < 0) { error += RANGE; }
+        if (error >= RANGE / 2) { error -= RANGE; }
+        const int k = k_parameter(context);
+        int mapped;
+        if (k == 0 && 2 * context.B <= -context.N) {
+            mapped = error >= 0 ? 2 * error + 1 : -2 * (error + 1);
+        } else {
+            mapped = error >= 0 ? 2 * error : -2 * error - 1;
+        }
+        write_code(bs, mapped, k);
+        update(context, error);
+    }
+}
+
+void LocoI::decode_line(BitStream &bs, Channel &state, const int *prev, int *cur, const int cols) {
+    for (int i = 1; i <= cols; i++) {
+        const int a = cur[i - 1], b = prev[i], c = prev[i - 1], d = prev[i + 1];
+        int sign;
+        const int index = context_index(a, b, c, d, sign);
+        if (index == 0) {
+            const int count = state.run.decode(bs, cols - i + 1);
+            for (int j = 0; j < count; j++) { cur[i + j] = a; }
+            i += count;
+            if (i > cols) { break; }
+            const int above = prev[i];
+            const bool same = a == above;
+            RunContext &context = state.run_contexts[same];
+            const int k = k_parameter(context, same);
+            const int mapped = read_code(bs, k);
+            const int t = mapped + static_cast<int>(same);
+            const bool map = (t & 1) != 0;
+            int error = (t + 1) >> 1;
+            if ((k != 0 || 2 * context.Nn >= context.N) == map) { error = -error; }
+            update(context, error, mapped, same);
+            if (!same && a > above) { error = -error; }
+            cur[i] = ((same ? a : above) + error) & (RANGE - 1);
+            continue;
+        }
+        Context &context = state.contexts[index];
+        const int predicted = min(max(predict(a, b, c) + sign * context.C, 0), RANGE - 1);
+        const int k = k_parameter(context);
+        const int mapped = read_code(bs, k);
+        int error;
+        if (k == 0 && 2 * context.B <= -context.N) {
+            error = (mapped & 1) != 0 ? (mapped - 1) / 2 : -(mapped / 2) - 1;
+        } else {
+            error = (mapped & 1) != 0 ? -((mapped + 1) / 2) : mapped / 2;
+        }
+        cur[i] = (predicted + sign * error) & (RANGE - 1);
+        update(context, error);
+    }
+}
+
+void LocoI::encode(const Mat &mat, BitStream &bs) {
+    reset();
+    const int cols = mat.cols;
+    // Two padded lines per channel, the previous one starts as zeros
+    vector<vector<int>> prev(channels, vector<int>(cols + 2, 0));
+    vector<vector<int>> cur(channels, vector<int>(cols + 2, 0));
+    for (int r = 0; r < mat.rows; r++) {
+        const auto *row = mat.ptr<uchar>(r);
+        for (int channel = 0; channel < channels; channel++) {
+            int *line = cur[channel].data();
+            int *above = prev[channel].data();
+            // Samples outside the image repeat their neighbours, as in JPEG-LS
+            line[0] = above[1];
+            above[cols + 1] = above[cols];
+            for (int c = 0; c < cols; c++) { line[c + 1] = row[c * channels + channel]; }
+            encode_line(bs, states[channel], above, line, cols);
+            swap(prev[channel], cur[channel]);
+        }
+    }
+}
+
+void LocoI::decode(Mat &mat, BitStream &bs) {
+    reset();
+    const int cols = mat.cols;
+    vector<vector<int>> prev(channels, vector<int>(cols + 2, 0));
+    vector<vector<int>> cur(channels, vector<int>(cols + 2, 0));
+    for (int r = 0; r < mat.rows; r++) {
+        auto *row = mat.ptr<uchar>(r);
+        for (int channel = 0; channel < channels; channel++) {
+            int *line = cur[channel].data();
+            int *above = prev[channel].data();
+            line[0] = above[1];
+            above[cols + 1] = above[cols];
+            decode_line(bs, states[channel], above, line, cols);
+            for (int c = 0; c < cols; c++) { row[c * channels + channel] = static_cast<uchar>(line[c + 1]); }
+            swap(prev[channel], cur[channel]);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file LocoI.hpp
+ * @brief LocoI class
+ * @ingroup codec
+ * Declares the LocoI class, which codes images with the LOCO-I (JPEG-LS) context model
+ */
+
+#pragma once
+
+#include "../io/BitStream.hpp"
+#include "RunMode.hpp"
+#include <array>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+/**
+ * @brief Codes the samples of an 8-bit image losslessly with the LOCO-I context model
+ * @details Each sample is predicted with MED and corrected by the bias of its context, which is picked from the
+ * quantized local gradients. The prediction error is Golomb-Rice coded with a k derived, for every sample, from the
+ * running statistics of its context. Where the local gradients are all zero, the coder switches to run mode and codes
+ * the length of the run of samples equal to the left one, followed by the sample that interrupts it, if any.
+ * Encoder and decoder update the contexts identically, so only the codes are stored.
+ * Every channel has its own contexts, and they are reset for every image, so images can be coded independently.
+ */
+class LocoI {
+public:
+    static constexpr int CONTEXTS = 365;///< Number of gradient contexts
+    static constexpr int RESET = 64;    ///< The context counts are halved when N reaches this
+    static constexpr int LIMIT = 32;    ///< Maximum length of a code in bits
+    static constexpr int QBPP = 8;      ///< Bits needed to hold a mapped error
+
+    /**
+     * \brief Constructor for the LocoI class
+     * \param channels number of channels of the images to code
+     */
+    explicit LocoI(int channels);
+
+    /**
+     * \brief Encodes an image
+     * \param mat image to encode, 8-bit with as many channels as given to the constructor
+     * \param bs BitStream to write to
+     */
+    void encode(const cv::Mat &mat, BitStream &bs);
+
+    /**
+     * \brief Decodes an image
+     * \param mat image to decode into, already allocated with the right size and type
+     * \param bs BitStream to read from
+     */
+    void decode(cv::Mat &mat, BitStream &bs);
+
+private:
+    //! Running statistics of a context
+    struct Context {
+        int A;///< sum of the absolute errors
+        int B;///< sum of the errors, after bias correction
+        int C;///< bias correction
+        int N;///< number of samples
+    };
+
+    //! Running statistics of the samples that interrupt runs
+    struct RunContext {
+        int A; ///< sum of the absolute errors
+        int N; ///< number of samples
+        int Nn;///< number of negative errors
+    };
+
+    //! Coding state of a channel
+    struct Channel {
+        std::array<Context, CONTEXTS> contexts;///< regular contexts
+        std::array<RunContext, 2> run_contexts;///< run interruption contexts, for a != b and a == b
+        RunMode run;                           ///< run length coder
+    };
+
+    int channels;                 ///< number of channels
+    std::vector<Channel> states;  ///< state of every channel
+
+    //! Sets every context back to its initial state
+    void reset();
+
+    //! Encodes a line of samples of one channel
+    //! @param bs BitStream to write to
+    //! @param state state of the channel
+    //! @param prev previous line, padded with one sample at each end
+    //! @param cur line to encode, padded in the same way
+    //! @param cols number of samples in the line
+    static void encode_line(BitStream &bs, Channel &state, const int *prev, const int *cur, int cols);
+
+    //! Decodes a line of samples of one channel
+    //! @param bs BitStream to read from
+    //! @param state state of the channel
+    //! @param prev previous line, padded with one sample at each end
+    //! @param cur line to decode into, padded in the same way
+    //! @param cols number of samples in the line
+    static void decode_line(BitStream &bs, Channel &state, const int *prev, int *cur, int cols);
+
+    //! Golomb-Rice parameter of a run interruption context
+    //! @param context the context
+    //! @param same whether the interrupting sample's left and upper neighbours are equal
+    //! @return the smallest k such that N * 2^k reaches A (plus N / 2 if same)
+    static int k_parameter(const RunContext &context, bool same);
+
+    //! Updates the statistics of a run interruption context
+    //! @param context the context
+    //! @param error the prediction error
+    //! @param mapped the mapped error that was coded
+    //! @param same whether the interrupting sample's left and upper neighbours are equal
+    static void update(RunContext &context, int error, int mapped, bool same);
+
+    //! Picks the context of a sample from its neighbours
+    //! @param a left neighbour
+    //! @param b upper neighbour
+    //! @param c upper left neighbour
+    //! @param d upper right neighbour
+    //! @param sign set to -1 if the gradients were negated to fold the context, 1 otherwise
+    //! @return the context index
+    static int context_index(int a, int b, int c, int d, int &sign);
+
+    //! Predicts a sample with the median edge detector
+    //! @param a left neighbour
+    //! @param b upper neighbour
+    //! @param c upper left neighbour
+    //! @return the prediction
+    static int predict(int a, int b, int c);
+
+    //! Golomb-Rice parameter of a context
+    //! @param context the context
+    //! @return the smallest k such that N * 2^k >= A
+    static int k_parameter(const Context &context);
+
+    //! Updates the statistics and the bias correction of a context with a coded error
+    //! @param context the context
+    //! @param error the prediction error
+    static void update(Context &context, int error);
+
+    //! Writes a mapped error with a length-limited Golomb-Rice code
+    //! @param bs BitStream to write to
+    //! @param value the mapped error
+    //! @param k the Golomb-Rice parameter
+    static void write_code(BitStream &bs, int value, int k);
+
+    //! Reads a mapped error written by write_code
+    //! @param bs BitStream to read from
+    //! @param k the Golomb-Rice parameter
+    //! @return the mapped error
+    static int read_code(BitStream &bs, int k);
+};
@@ -0,0 +1,120 @@
+/**
+ * @file MedKernel.hpp
+ * @brief MedKernel struct
+ * @ingroup Codec
+ * Declares the row kernels of the JPEG-LS median edge detector, for frames with one or three channels.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+/**
+ * \brief Median edge detector of JPEG-LS
+ * \details The median of a, b and a + b - c, which is the same as picking min(a, b) over an edge, max(a, b) under it
+ * and the planar prediction elsewhere, without branching.
+ * \param a left neighbour
+ * \param b upper neighbour
+ * \param c upper left neighbour
+ * \return the prediction
+ */
+inline int med(const int a, const int b, const int c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), a + b - c));
+}
+
+/**
+ * \brief Predicts the samples of a row from pointers to it and to the row above
+ * \details Samples are interleaved, Channels to a pixel. A sample of the first row is predicted by its left neighbour,
+ * one of the first column by its upper neighbour, and the first sample by 0; every other one by med. The first row and
+ * column are handled before the loop, which then needs no bounds checks.
+ * \tparam Channels number of channels of the frame, 1 or 3
+ */
+template<int Channels>
+struct MedKernel {
+    static constexpr int CHANNELS = Channels;//!< Number of channels of the frame
+
+    /**
+     * \brief Prediction of any sample
+     * \param row first sample of the row
+     * \param above first sample of the row above, nullptr for the first row
+     * \param col column of the sample
+     * \param channel channel of the sample
+     * \return the prediction
+     */
+    static int predict(const uint8_t *row, const uint8_t *above, const int col, const int channel) {
+        const int i = col * Channels + channel;
+        if (above == nullptr) { return col == 0 ? 0 : row[i - Channels]; }
+        if (col == 0) { return above[i]; }
+        return med(row[i - Channels], above[i], above[i - Channels]);
+    }
+
+    /**
+     * \brief Computes the residuals of a row whose samples are all known, as when losslessly encoding
+     * \details The loop has no dependency between samples, so it can be vectorised
+     * \param row first sample of the row
+     * \param above first sample of the row above, nullptr for the first row
+     * \param cols number of pixels of the row
+     * \param residuals where to store the sample minus its prediction, cols * Channels of them
+     */
+    static void residuals(const uint8_t *row, const uint8_t *above, const int cols, int *residuals) {
+        const int n = cols * Channels;
+        if (above == nullptr) {
+            for (int i = 0; i < std::min(n, Channels); i++) { residuals[i] = row[i]; }
+            for (int i = Channels; i < n; i++) { residuals[i] = row[i] - row[i - Channels]; }
+            return;
+        }
+        for (int i = 0; i < std::min(n, Channels); i++) { residuals[i] = row[i] - above[i]; }
+        for (int i = Channels; i < n; i++) {
+            residuals[i] = row[i] - med(row[i - Channels], above[i], above[i - Channels]);
+        }
+    }
+
+    /**
+     * \brief Rebuilds a row sample by sample, each from the ones rebuilt before it, as when decoding
+     * \param row first sample of the row, overwritten with the rebuilt samples
+     * \param above first sample of the row above, nullptr for the first row
+     * \param cols number of pixels of the row
+     * \param sample callable taking the index of a sample in the row and its prediction, and returning the sample
+     */
+    template<typename F>
+    static void reconstruct(uint8_t *row, const uint8_t *above, const int cols, F &&sample) {
+        reconstruct(row, above, 0, cols, std::forward<F>(sample));
+    }
+
+    /**
+     * \brief Rebuilds some columns of a row, the ones before them being rebuilt already
+     * \param row first sample of the row, overwritten with the rebuilt samples
+     * \param above first sample of the row above, nullptr for the first row
+     * \param begin first column to rebuild
+     * \param end column after the last one to rebuild
+     * \param sample callable taking the index of a sample in the row and its prediction, and returning the sample
+     */
+    template<typename F>
+    static void reconstruct(uint8_t *row, const uint8_t *above, const int begin, const int end, F &&sample) {
+        int i = begin * Channels;
+        const int n = end * Channels;
+        if (begin == 0) {
+            for (; i < std::min(n, Channels); i++) { row[i] = sample(i, above == nullptr ? 0 : above[i]); }
+        }
+        if (above == nullptr) {
+            for (; i < n; i++) { row[i] = sample(i, row[i - Channels]); }
+            return;
+        }
+        for (; i < n; i++) { row[i] = sample(i, med(row[i - Channels], above[i], above[i - Channels])); }
+    }
+};
+
+/**
+ * \brief Calls a function with the kernel of a channel count
+ * \param channels 1 or 3
+ * \param f generic callable, called with MedKernel<1> or MedKernel<3>
+ */
+template<typename F>
+void withMedKernel(const int channels, F &&f) {
+    if (channels == 1) {
+        std::forward<F>(f)(MedKernel<1>());
+    } else {
+        std::forward<F>(f)(MedKernel<3>());
+    }
+}
@@ -0,0 +1,33 @@
+#include "RunMode.hpp"
+
+constexpr int RunMode::J[32];
+
+void RunMode::encode(BitStream &bs, int count, const int remaining) {
+    const bool end_of_line = count == remaining;
+    while (count >= (1 << J[index])) {
+        bs.writeBit(1);
+        count -= 1 << J[index];
+        if (index < 31) { index++; }
+    }
+    if (end_of_line) {
+        // A partial segment at the end of the line is a single 1, its length is known from the line
+        if (count > 0) { bs.writeBit(1); }
+        return;
+    }
+    bs.writeBits(static_cast<uint64_t>(count), J[index] + 1);
+    if (index > 0) { index--; }
+}
+
+int RunMode::decode(BitStream &bs, const int remaining) {
+    int count = 0;
+    while (bs.readBit() == 1) {
+        const int segment = 1 << J[index];
+        if (segment > remaining - count) { return remaining; }
+        count += segment;
+        if (index < 31) { index++; }
+        if (count == remaining) { return count; }
+    }
+    count += static_cast<int>(bs.readBits(J[index]));
+    if (index > 0) { index--; }
+    return count;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file RunMode.hpp
+ * @brief RunMode class
+ * @ingroup codec
+ * Declares the RunMode class, the adaptive run-length coder of JPEG-LS run mode
+ */
+
+#pragma once
+
+#include "../io/BitStream.hpp"
+
+/**
+ * @brief Codes the lengths of runs of flat samples along a line, as in JPEG-LS run mode
+ * @details Runs are split in segments of 2^J[index] samples, each written as a single 1 bit. The index grows after
+ * every complete segment and shrinks after every run that is interrupted before the end of the line, so long runs cost
+ * a few bits. An interrupted run ends with a 0 and the rest of its length in J[index] bits.
+ * Encoder and decoder must start from the same state and code the same sequence of runs.
+ */
+class RunMode {
+    int index = 0;///< position in J, adapted to the length of the recent runs
+
+public:
+    static constexpr int J[32] = {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3,  3,
+                                  4, 4, 5, 5, 6, 6, 7, 7, 8, 9, 10, 11, 12, 13, 14, 15};///< Segment sizes, as powers of 2
+
+    /**
+     * \brief Writes the length of a run
+     * \param bs BitStream to write to
+     * \param count length of the run
+     * \param remaining number of samples left in the line, including the run. A run as long as this reaches the end of
+     * the line, any other is interrupted by the sample after it
+     */
+    void encode(BitStream &bs, int count, int remaining);
+
+    /**
+     * \brief Reads the length of a run written by encode
+     * \param bs BitStream to read from
+     * \param remaining number of samples left in the line
+     * \return length of the run, equal to remaining if it reaches the end of the line
+     */
+    int decode(BitStream &bs, int remaining);
+};
@@ -0,0 +1,67 @@
+#include "Slices.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+//! Splits a length into whole units as evenly as possible, the rest going to the last band
+vector<int> split(const int length, const int count, const int unit) {
+    const int units = length / unit;
+    const int bands = max(min(count, units), 1);
+    vector<int> bounds;
+    for (int band = 0; band < bands; band++) { bounds.push_back(units * band / bands * unit); }
+    bounds.push_back(length);
+    return bounds;
+}
+}// namespace
+
+Slices::Slices(const int width, const int height, const int count, const int tiles, const int unit)
+    : bounds(split(height, count, max(unit, 1))), columns(split(width, tiles, max(unit, 1))), unit_(max(unit, 1)) {}
+
+int Slices::count() const { return slices() * tiles(); }
+
+int Slices::slices() const { return static_cast<int>(bounds.size()) - 1; }
+
+int Slices::tiles() const { return static_cast<int>(columns.size()) - 1; }
+
+int Slices::unit() const { return unit_; }
+
+int Slices::begin(const int tile) const { return bounds[tile / tiles()]; }
+
+int Slices::end(const int tile) const { return bounds[tile / tiles() + 1]; }
+
+int Slices::left(const int tile) const { return columns[tile % tiles()]; }
+
+int Slices::right(const int tile) const { return columns[tile % tiles() + 1]; }
+
+int Slices::begin_unit(const int tile) const { return begin(tile) / unit_; }
+
+int Slices::end_unit(const int tile) const { return end(tile) / unit_; }
+
+cv::Mat Slices::tile_columns(const cv::Mat &mat, const int tile) const {
+    return mat(cv::Rect(left(tile), 0, right(tile) - left(tile), mat.rows));
+}
+
+void Substreams::write(BitStream &bs, vector<BitStream> &parts) {
+    for (BitStream &part: parts) {
+        part.flushBuffer();
+        bs.writeBits(part.size(), 32);
+    }
+    for (const BitStream &part: parts) { bs.append(part.data(), static_cast<uint64_t>(part.size()) * 8); }
+}
+
+void Substreams::read(BitStream &bs, const int parts) {
+    offsets.assign(parts + 1, 0);
+    for (int part = 0; part < parts; part++) { offsets[part + 1] = offsets[part] + static_cast<size_t>(bs.readBits(32)); }
+    bytes.resize(offsets[parts]);
+    size_t byte = 0;
+    for (; byte + 4 <= bytes.size(); byte += 4) {
+        const auto word = static_cast<uint32_t>(bs.readBits(32));
+        for (int i = 0; i < 4; i++) { bytes[byte + i] = static_cast<uint8_t>(word >> (24 - 8 * i)); }
+    }
+    for (; byte < bytes.size(); byte++) { bytes[byte] = static_cast<uint8_t>(bs.readBits(8)); }
+}
+
+const uint8_t *Substreams::data(const int part) const { return bytes.data() + offsets[part]; }
+
+size_t Substreams::size(const int part) const { return offsets[part + 1] - offsets[part]; }
@@ -0,0 +1,184 @@
+/**
+ * @file Slices.hpp
+ * @brief Slices and Substreams classes
+ * @ingroup Codec
+ * Declares the Slices class, which splits frames into bands of rows and those into tiles that are coded on their own,
+ * and the Substreams class, which lists the parts of a frame that were coded into BitStreams of their own.
+ */
+
+#pragma once
+#include "../io/BitStream.hpp"
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+/**
+ * \brief Splits frames into slices, bands of whole rows, and every slice into tiles, bands of whole columns
+ * \details Every tile is predicted as if its first row were the first row of the frame and its first column the first
+ * column of the frame, and is entropy coded with coders of its own, so tiles can be encoded and decoded in any order
+ * and on several threads. Tiles are numbered row by row, and a slice without tiles is a single tile. Slices and tiles
+ * are made of whole units, which are the blocks of frames with motion vectors, and the rows and columns left over at
+ * the bottom and at the right go to the last slice and to the last tile.
+ */
+class Slices {
+    std::vector<int> bounds; ///< first row of every slice, then the height of the frame
+    std::vector<int> columns;///< first column of every tile of a slice, then the width of the frame
+    int unit_;               ///< rows and columns of a unit
+
+public:
+    /**
+     * \brief Splits a frame as evenly as possible
+     * \param width width of the frame
+     * \param height height of the frame
+     * \param count number of slices, there are fewer if the frame doesn't have enough rows of units
+     * \param tiles number of tiles of every slice, there are fewer if the frame doesn't have enough columns of units
+     * \param unit rows and columns of a unit
+     */
+    Slices(int width, int height, int count, int tiles = 1, int unit = 1);
+
+    /**
+     * \brief Gets the number of tiles of the frame
+     * \return the number of slices times the number of tiles of a slice
+     */
+    int count() const;
+
+    /**
+     * \brief Gets the number of slices
+     * \return the number of slices
+     */
+    int slices() const;
+
+    /**
+     * \brief Gets the number of tiles of a slice
+     * \return the number of tiles of a slice
+     */
+    int tiles() const;
+
+    /**
+     * \brief Gets the rows and columns of a unit
+     * \return the rows and columns of a unit
+     */
+    int unit() const;
+
+    /**
+     * \brief Gets the first row of a tile
+     * \param tile the tile
+     * \return the first row
+     */
+    int begin(int tile) const;
+
+    /**
+     * \brief Gets the row after the last row of a tile
+     * \param tile the tile
+     * \return the row after the last one
+     */
+    int end(int tile) const;
+
+    /**
+     * \brief Gets the first column of a tile
+     * \param tile the tile
+     * \return the first column
+     */
+    int left(int tile) const;
+
+    /**
+     * \brief Gets the column after the last column of a tile
+     * \param tile the tile
+     * \return the column after the last one
+     */
+    int right(int tile) const;
+
+    /**
+     * \brief Gets the first whole row of units of a tile
+     * \param tile the tile
+     * \return index of the row of units, such as the row of blocks
+     */
+    int begin_unit(int tile) const;
+
+    /**
+     * \brief Gets the row of units after the last whole row of units of a tile
+     * \details Rows left over at the bottom of the frame aren't a whole unit
+     * \param tile the tile
+     * \return index of the row of units after the last one
+     */
+    int end_unit(int tile) const;
+
+    /**
+     * \brief Gets the columns of a tile
+     * \param mat the frame
+     * \param tile the tile
+     * \return every row of the columns of the tile, sharing the samples of the frame
+     */
+    cv::Mat tile_columns(const cv::Mat &mat, int tile) const;
+
+    /**
+     * \brief Calls a function with the whole units of every row of units of a tile, in raster order
+     * \param tile the tile
+     * \param units_per_row whole units of every row of the frame
+     * \param f callable taking the index of the first unit of the row of the tile and of the unit after the last one
+     */
+    template<typename F>
+    void unit_rows(int tile, size_t units_per_row, F &&f) const;
+
+    /**
+     * \brief Calls a function for every tile, on OpenMP threads
+     * \param f callable taking the index of the tile
+     */
+    template<typename F>
+    void run(F &&f) const;
+};
+
+template<typename F>
+void Slices::unit_rows(const int tile, const size_t units_per_row, F &&f) const {
+    // Columns left over at the right of the frame aren't a whole unit
+    const size_t left_unit = left(tile) / unit_;
+    const size_t right_unit = right(tile) / unit_;
+    for (int row = begin_unit(tile); row < end_unit(tile); row++) {
+        f(row * units_per_row + left_unit, row * units_per_row + right_unit);
+    }
+}
+
+template<typename F>
+void Slices::run(F &&f) const {
+    const int tiles = count();
+#pragma omp parallel for default(none) shared(f, tiles) schedule(dynamic, 1)
+    for (int tile = 0; tile < tiles; tile++) { f(tile); }
+}
+
+/**
+ * \brief The substreams of the parts of a frame, such as its slices or its rows
+ * \details Every part is coded into a BitStream of its own, and write appends the size of each one in bytes and then
+ * their bytes. read loads them back, so every part can be decoded from its own in-memory BitStream.
+ */
+class Substreams {
+    std::vector<uint8_t> bytes; ///< bytes of every part
+    std::vector<size_t> offsets;///< offset of every part in bytes, and the end of the last one
+
+public:
+    /**
+     * \brief Writes the substreams of the parts of a frame
+     * \param bs BitStream to write to
+     * \param parts substream of each part, flushed as they are written
+     */
+    static void write(BitStream &bs, std::vector<BitStream> &parts);
+
+    /**
+     * \brief Reads the substreams written by write
+     * \param bs BitStream to read from
+     * \param parts number of parts
+     */
+    void read(BitStream &bs, int parts);
+
+    /**
+     * \brief Gets the bytes of a part
+     * \param part the part
+     * \return pointer to its first byte
+     */
+    const uint8_t *data(int part) const;
+
+    /**
+     * \brief Gets the size of a part
+     * \param part the part
+     * \return number of bytes of the part
+     */
+    size_t size(int part) const;
+};
@@ -0,0 +1,106 @@
+/**
+ * @file TemporalKernel.hpp
+ * @brief TemporalKernel class
+ * @ingroup Codec
+ * Declares the row kernels of the temporal predictor, which blends the median edge detector with the previous frame.
+ */
+
+#pragma once
+#include "MedKernel.hpp"
+#include <cstdlib>
+#include <vector>
+
+/**
+ * \brief Predicts the samples of a row from the row above and the same row of the previous frame
+ * \details Every sample has two predictions: the spatial one of MedKernel, and the co-located sample of the previous
+ * frame. Both are weighed by how well they did on the left, upper left, upper and upper right neighbours of the sample,
+ * each weight being the square of the other prediction's error, so static areas follow the previous frame and moving
+ * ones the frame itself. The errors of the previous frame are mostly noise, which the spatial prediction has as well, so
+ * the previous frame gets the weight of twice the spatial error. The errors of the row above are kept between calls, so
+ * the rows of a slice must be handed in order, starting with its first one.
+ * \tparam Channels number of channels of the frame, 1 or 3
+ */
+template<int Channels>
+class TemporalKernel {
+    std::vector<int> errors_;///< errors of both predictions on the row above and the current one, padded by a pixel
+    int cols_;               ///< number of pixels of a row
+
+public:
+    /**
+     * \brief Constructor
+     * \param cols number of pixels of a row
+     */
+    explicit TemporalKernel(const int cols) : errors_(4 * (cols + 2) * Channels), cols_(cols) {}
+
+    /**
+     * \brief Computes the residuals of a row whose samples are all known, as when losslessly encoding
+     * \param row first sample of the row
+     * \param above first sample of the row above, nullptr for the first row of a slice
+     * \param previous first sample of the same row of the previous frame
+     * \param residuals where to store the sample minus its prediction, cols * Channels of them
+     */
+    void residuals(const uint8_t *row, const uint8_t *above, const uint8_t *previous, int *residuals) {
+        sweep(row, above, previous, [row, residuals](const int i, const int predicted) {
+            residuals[i] = row[i] - predicted;
+            return row[i];
+        });
+    }
+
+    /**
+     * \brief Rebuilds a row sample by sample, each from the ones rebuilt before it, as when decoding
+     * \param row first sample of the row, overwritten with the rebuilt samples
+     * \param above first sample of the row above, nullptr for the first row of a slice
+     * \param previous first sample of the same row of the previous frame
+     * \param sample callable taking the index of a sample in the row and its prediction, and returning the sample
+     */
+    template<typename F>
+    void reconstruct(uint8_t *row, const uint8_t *above, const uint8_t *previous, F &&sample) {
+        sweep(row, above, previous, [row, &sample](const int i, const int predicted) {
+            row[i] = sample(i, predicted);
+            return row[i];
+        });
+    }
+
+private:
+    //! Calls f with the index and the prediction of every sample, f returns the actual sample
+    template<typename Row, typename F>
+    void sweep(Row *row, const uint8_t *above, const uint8_t *previous, F &&f) {
+        const int n = cols_ * Channels;
+        const int stride = (cols_ + 2) * Channels;
+        // The rows of errors swap places, so the current row of the last call is now the row above
+        if (above == nullptr) {
+            std::fill(errors_.begin(), errors_.end(), 0);
+        } else {
+            std::swap_ranges(errors_.begin(), errors_.begin() + 2 * stride, errors_.begin() + 2 * stride);
+        }
+        int *spatial_above = errors_.data() + Channels;
+        int *temporal_above = spatial_above + stride;
+        int *spatial = temporal_above + stride;
+        int *temporal = spatial + stride;
+        for (int i = 0; i < n; i++) {
+            int med_prediction;
+            if (above == nullptr) {
+                med_prediction = i < Channels ? previous[i] : row[i - Channels];
+            } else if (i < Channels) {
+                med_prediction = above[i];
+            } else {
+                med_prediction = med(row[i - Channels], above[i], above[i - Channels]);
+            }
+            // The errors of the rows are padded with zeros, so the edges need no checks
+            const int spatial_error = spatial[i - Channels] + spatial_above[i - Channels] + spatial_above[i] +
+                                      spatial_above[i + Channels];
+            const int temporal_error = temporal[i - Channels] + temporal_above[i - Channels] + temporal_above[i] +
+                                       temporal_above[i + Channels];
+            // The errors are at most 4 * 255, so the weighted sum fits an int
+            const int spatial_weight = temporal_error * temporal_error;
+            const int temporal_weight = 4 * spatial_error * spatial_error;
+            const int total = spatial_weight + temporal_weight;
+            const int predicted = total == 0 ? previous[i]
+                                             : (med_prediction * spatial_weight + previous[i] * temporal_weight +
+                                                total / 2) / total;
+            const int actual = f(i, predicted);
+            spatial[i] = std::abs(actual - med_prediction);
+            temporal[i] = std::abs(actual - previous[i]);
+        }
+    }
+};
@@ -0,0 +1,18 @@
+#include "Wavefront.hpp"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+constexpr int Wavefront::STEP;
+
+Wavefront::Wavefront(const int rows) : progress(new atomic<int>[max(rows, 0)]), rows(rows) {
+    for (int r = 0; r < rows; r++) { progress[r].store(0, memory_order_relaxed); }
+}
+
+void Wavefront::wait(const int row, const int done) const {
+    if (row < 0) { return; }
+    while (progress[row].load(memory_order_acquire) < done) { this_thread::yield(); }
+}
+
+void Wavefront::publish(const int row, const int done) { progress[row].store(done, memory_order_release); }
@@ -0,0 +1,61 @@
+/**
+ * @file Wavefront.hpp
+ * @brief Wavefront class
+ * @ingroup Codec
+ * Declares the Wavefront class, which decodes the rows of a frame on several threads.
+ */
+
+#pragma once
+#include "Slices.hpp"
+#include <atomic>
+#include <memory>
+
+/**
+ * \brief Runs a function for every row of a frame on several threads, each row lagging behind the row above
+ * \details A sample only depends on its neighbours to the left, above and above to the right, so a row can be decoded
+ * as soon as the row above is a little ahead of it. Rows are handed to the threads in order; every row publishes how
+ * far it got, and waits before reading parts of the row above that may not be done yet. The rows must be coded in
+ * substreams of their own (see Substreams), so that every thread knows where its row starts.
+ */
+class Wavefront {
+    std::unique_ptr<std::atomic<int>[]> progress;///< units done of each row, in whatever unit the rows agree on
+    int rows;                                    ///< number of rows
+
+public:
+    static constexpr int STEP = 16;///< Columns a row should decode between two updates of its progress
+
+    /**
+     * \brief Constructor, no row is done
+     * \param rows number of rows
+     */
+    explicit Wavefront(int rows);
+
+    /**
+     * \brief Waits until a row is done up to a point
+     * \param row the row, nothing is waited for if it is negative
+     * \param done units of the row that must be done
+     */
+    void wait(int row, int done) const;
+
+    /**
+     * \brief Publishes how far a row got
+     * \param row the row
+     * \param done units of the row that are done, from the start of the row
+     */
+    void publish(int row, int done);
+
+    /**
+     * \brief Calls a function for every row, on OpenMP threads
+     * \param f callable taking the index of the row, which must publish its progress
+     */
+    template<typename F>
+    void run(F &&f);
+};
+
+template<typename F>
+void Wavefront::run(F &&f) {
+    const int count = rows;
+    // Rows are handed out one at a time and in order, so the row a thread waits for is always being decoded
+#pragma omp parallel for default(none) shared(f, count) schedule(dynamic, 1)
+    for (int r = 0; r < count; r++) { f(r); }
+}
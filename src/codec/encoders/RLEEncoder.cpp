@@ -1,29 +1,35 @@
 #include "RLEEncoder.hpp"
+#include "../../io/Rice.hpp"
 
 using namespace std;
 
-RLEEncoder::RLEEncoder(Golomb *golomb) {
-    g = golomb;
+template<typename Coder>
+RLEEncoder<Coder>::RLEEncoder(Coder *coder) {
+    g = coder;
     last_value = 0;
     cnt = 0;
 }
 
-RLEEncoder::~RLEEncoder() {
+template<typename Coder>
+RLEEncoder<Coder>::~RLEEncoder() {
     flush_buffer();
 }
 
-void RLEEncoder::flush_buffer() {
+template<typename Coder>
+void RLEEncoder<Coder>::flush_buffer() {
     g->encode(cnt);
     g->encode(last_value);
     cnt = 0;
 }
 
-void RLEEncoder::fetch_buffer() {
+template<typename Coder>
+void RLEEncoder<Coder>::fetch_buffer() {
     cnt = g->decode();
     last_value = g->decode();
 }
 
-void RLEEncoder::push(const int value) {
+template<typename Coder>
+void RLEEncoder<Coder>::push(const int value) {
     if (value != last_value && cnt != 0) {
         flush_buffer();
     }
@@ -31,10 +37,16 @@ void RLEEncoder::push(const int value) {
     last_value = value;
 }
 
-int RLEEncoder::pop() {
+template<typename Coder>
+int RLEEncoder<Coder>::pop() {
     if (cnt == 0) {
         fetch_buffer();
     }
     cnt -= 1;
     return last_value;
-}
\ No newline at end of file
+}
+
+template class RLEEncoder<Golomb>;
+template class RLEEncoder<Rice>;
+template class RLEEncoder<Rans>;
+template class RLEEncoder<Cabac>;
@@ -6,13 +6,18 @@
 #pragma once
 #include "../Encoder.hpp"
 
+/**
+ * @brief Run-length codes a sequence of ints, writing every run as its length and value
+ * @tparam Coder any coder with encode(int) and decode(), such as Golomb, Rice, Rans or Cabac
+ */
+template<typename Coder>
 class RLEEncoder {
-    Golomb *g;
+    Coder *g;
     int last_value;
     int cnt;
 
 public:
-    explicit RLEEncoder(Golomb *golomb);
+    explicit RLEEncoder(Coder *coder);
     ~RLEEncoder();
     void flush_buffer();
     void fetch_buffer();
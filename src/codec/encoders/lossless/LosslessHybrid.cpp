@@ -1,26 +1,19 @@
 #include "LosslessHybrid.hpp"
+#include "../../../io/Rice.hpp"
 #include "../../../visual/ImageProcessing.hpp"
 #include "../../../visual/Video.hpp"
 
 using namespace std;
 using namespace cv;
 
-HybridHeader::HybridHeader(const Header &header) : InterHeader() {
-    this->color_space = header.color_space;
-    this->chroma_subsampling = header.chroma_subsampling;
-    this->height = header.height;
-    this->width = header.width;
-    this->golomb_m = header.golomb_m;
-    this->length = header.length;
-    this->fps_num = header.fps_num;
-    this->fps_den = header.fps_den;
-}
+HybridHeader::HybridHeader(const Header &header) : InterHeader(header) {}
 
 void HybridHeader::write_header(BitStream &bs) const {
     Header::write_header(bs);
     bs.writeBits(block_size, 8);
     bs.writeBits(period, 8);
     bs.writeBits(search_radius, 8);
+    golomb_parameters.write(bs);
 }
 
 HybridHeader HybridHeader::read_header(BitStream &bs) {
@@ -28,6 +21,7 @@ HybridHeader HybridHeader::read_header(BitStream &bs) {
     header.block_size = bs.readBits(8);
     header.period = bs.readBits(8);
     header.search_radius = bs.readBits(8);
+    header.golomb_parameters = GolombParameters::read(bs);
     return header;
 }
 
@@ -39,92 +33,91 @@ LosslessHybridEncoder::LosslessHybridEncoder(const char *src, const char *dst)
 LosslessHybridEncoder::LosslessHybridEncoder(const char *src) : src(src), golomb_m(0), block_size(0) {}
 
 void LosslessHybridEncoder::encode() {
-    BitStream bs(dst, ios::out);
-    Golomb g(&bs);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     const Video vid(src);
     const vector<Frame *> frames = vid.generate_frames();
     const Frame sample = *frames[0];
+    // Slices and tiles are made of whole blocks, so that intra and inter frames are split alike
+    const Slices frame_slices(sample.get_image().size().width, sample.get_image().size().height, min(slices, 255),
+                              min(tiles, 255), block_size);
+    // The residuals of BGR frames are decorrelated with YCoCg-R as they are written
+    const bool transform = color_transform && sample.get_image().get_color() == BGR;
     int cnt = period;
     int last_intra = 0;
     vector<Frame *> intra_frames;
     vector<Frame *> inter_frames;
-    for (int index = 0; index < frames.size(); index++) {
+    for (size_t index = 0; index < frames.size(); index++) {
         Frame *frame = frames[index];
+        frame->set_color_transform(transform);
         if (cnt == period) {
-            frame->encode_JPEG_LS();
+            frame->encode_JPEG_LS(frame_slices);
             intra_frames.push_back(frame);
             last_intra = index;
             cnt = 0;
         } else {
-            const Frame *frame_intra = frames[last_intra];
             inter_frames.push_back(frame);
-            frame->calculate_MV(*frame_intra, block_size, header.search_radius, true);
-            cnt++;
-        }
-    }
-    if (golomb_m == 0) {
-        // Best m
-        double sum = 0;
-        const auto intra = sample_frames(intra_frames, sample_factor);
-        const auto inter = sample_frames(inter_frames, sample_factor);
-        for (auto &frame: intra) { sum += Golomb::adjust_m(frame->get_intra_encoding()); }
-        for (auto &frame: inter) {
-            vector<int> inter_encoding;
-            for (auto &mv: frame->get_motion_vectors()) {
-                inter_encoding.push_back(mv.x);
-                inter_encoding.push_back(mv.y);
-                for (int row = 0; row < block_size; row++) {
-                    for (int col = 0; col < block_size; col++) {
-                        auto residual = mv.residual.at<Vec3s>(row, col);
-                        inter_encoding.push_back(residual[0]);
-                        inter_encoding.push_back(residual[1]);
-                        inter_encoding.push_back(residual[2]);
-                    }
-                }
+            if (temporal) {
+                // Lossless frames are rebuilt exactly, so the previous frame is the decoder's reference
+                frame->encode_temporal(*frames[index - 1], frame_slices);
+            } else {
+                const Frame *frame_intra = frames[last_intra];
+                frame->calculate_MV(*frame_intra, block_size, header.search_radius, true);
             }
-            sum += Golomb::adjust_m(inter_encoding);
+            cnt++;
         }
-        auto size = intra.size() + inter.size();
-        const int k = static_cast<int>(sum / static_cast<double>(size));
-        const int golomb_m = 1 << k;
-        this->golomb_m = golomb_m;
     }
-    g.set_m(golomb_m);
+    // Every class of syntax element gets its own m, picked from a sample of frames unless m was given
+    // The block coders fit their tables or probabilities to every frame, so they need no parameters
+    const GolombParameters parameters =
+            entropy_coder != GOLOMB || golomb_m != 0
+                    ? GolombParameters::uniform(golomb_m)
+                    : estimate_golomb_parameters(intra_frames, inter_frames, sample_factor);
     header.extract_info(sample);
     header.golomb_m = golomb_m;
+    header.golomb_limit = Golomb::DEFAULT_LIMIT;
+    header.entropy_coder = entropy_coder;
+    header.slices = frame_slices.slices();
+    header.tiles = frame_slices.tiles();
+    header.color_transform = transform;
+    header.temporal = temporal;
     header.length = frames.size();
     header.block_size = block_size;
     header.period = period;
+    header.golomb_parameters = parameters;
     header.write_header(bs);
     // REPORT: moving writes to separate loop (-10s)
-    for (auto &frame: frames) {
-        if (frame->get_type() == P_FRAME) {
-            frame->write(g);
-        } else {
-            frame->write_JPEG_LS(g);
-        }
-    }
+    // Each frame is written to its own buffer in parallel, and the buffers are spliced in order as they are done
+    const int limit = header.golomb_limit;
+    const ENTROPY_CODER coder = entropy_coder;
+    encodeInOrder(
+            frames.size(),
+            [&](const size_t index, BitStream &stream) {
+                frames[index]->write_frame(stream, coder, parameters, limit, frame_slices);
+            },
+            [&bs](BitStream &stream) { bs.append(stream); });
+    close_output(bs);
 }
 
 void LosslessHybridEncoder::decode() {
     BitStream bs(src, ios::in);
-    Golomb g(&bs);
     header = HybridHeader::read_header(bs);
     block_size = header.block_size;
     period = header.period;
     golomb_m = header.golomb_m;
-    g.set_m(header.golomb_m);
+    // The tiles of every frame are decoded in parallel, the frames in order
+    const Slices frame_slices(static_cast<int>(header.width), static_cast<int>(header.height), header.slices,
+                              header.tiles, block_size);
     int cnt = period;
     int last_intra = 0;
-    for (int index = 0; index < header.length; index++) {
+    for (uint32_t index = 0; index < header.length; index++) {
         if (cnt == period) {
-            frames.push_back(Frame::decode_JPEG_LS(g, static_cast<Header>(header))); // NOLINT(*-slicing)
+            frames.push_back(Frame::read_frame(bs, header, frame_slices, nullptr));
             last_intra = index;
             cnt = 0;
         } else {
-            Frame frame_intra = frames[last_intra];
-            header.block_size = block_size;
-            frames.push_back(Frame::decode_inter(g, frame_intra, header));
+            Frame reference = header.temporal ? frames.back() : frames[last_intra];
+            frames.push_back(Frame::read_frame(bs, header, frame_slices, &reference));
             cnt++;
         }
     }
@@ -1,4 +1,5 @@
 #include "LosslessInter.hpp"
+#include "../../../io/Rice.hpp"
 #include "../../../visual/ImageProcessing.hpp"
 #include "../../../visual/Video.hpp"
 
@@ -11,37 +12,48 @@ LosslessInterFrameEncoder::LosslessInterFrameEncoder(const char *src, const char
 
 void LosslessInterFrameEncoder::encode() {
     const Video vid(src);
-    BitStream bs(dst, ios::out);
-    Golomb g(&bs);
-    g.set_m(golomb_m);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     const vector<Frame *> frames = vid.generate_frames();
     const Frame sample = *frames[0];
+    frames[0]->encode_JPEG_LS();
+#pragma omp parallel for default(none) shared(frames)
+    for (size_t i = 1; i < frames.size(); i++) {
+        frames[i]->calculate_MV(*frames[i - 1], block_size, 7, true);
+    }
+    const vector<Frame *> inter_frames(frames.begin() + 1, frames.end());
     header.extract_info(sample);
     header.golomb_m = golomb_m;
+    header.golomb_limit = Golomb::DEFAULT_LIMIT;
     header.length = frames.size();
     header.block_size = block_size;
+    header.entropy_coder = entropy_coder;
+    header.golomb_parameters = entropy_coder == GOLOMB && golomb_m == 0
+                                       ? estimate_golomb_parameters({frames[0]}, inter_frames, sample_factor)
+                                       : GolombParameters::uniform(golomb_m);
     header.write_header(bs);
-    Frame *last = frames[0];
-    last->encode_JPEG_LS(g);
-#pragma omp parallel for default(none) shared(frames, last)
-    for (int i = 1; i < frames.size(); i++) {
-        Frame *current = frames[i];
-        current->calculate_MV(*last, block_size, 7, true);
-        last = current;
-    }
-    for (auto &frame: frames) {
-        frame->write(g);
-    }
+    withEntropyCoders(entropy_coder, &bs, header.golomb_parameters, header.golomb_limit,
+                      [&frames, &inter_frames, &bs](auto &g) {
+                          frames[0]->write_JPEG_LS(g);
+                          g.end_frame(bs);
+                          for (auto &frame: inter_frames) {
+                              frame->write(g);
+                              g.end_frame(bs);
+                          }
+                      });
+    close_output(bs);
 }
 
 void LosslessInterFrameEncoder::decode() {
     BitStream bs(src, ios::in);
-    Golomb golomb(&bs);
     header = InterHeader::read_header(bs);
-    golomb.set_m(header.golomb_m);
-    frames.push_back(Frame::decode_JPEG_LS(golomb, static_cast<Header>(header))); // NOLINT(*-slicing)
-    for (int i = 1; i < header.length - 1; i++) {
-        Frame img = Frame::decode_inter(golomb, frames[i - 1], header);
-        frames.push_back(img);
-    }
+    withEntropyCoders(header.entropy_coder, &bs, header.golomb_parameters, header.golomb_limit, [this, &bs](auto &g) {
+        g.begin_frame(bs);
+        frames.push_back(Frame::decode_intra(g, static_cast<Header>(header))); // NOLINT(*-slicing)
+        for (uint32_t i = 1; i < header.length; i++) {
+            g.begin_frame(bs);
+            Frame img = Frame::decode_inter(g, frames[i - 1], header);
+            frames.push_back(img);
+        }
+    });
 }
\ No newline at end of file
@@ -32,6 +32,7 @@ public:
     InterHeader header{};
     uint8_t golomb_m;
     uint8_t block_size;
+    int sample_factor = 100;
     /**
      * \brief Encodes a video from src into dst using interframe encoding
      */
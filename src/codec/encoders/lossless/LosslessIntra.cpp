@@ -1,4 +1,6 @@
 #include "LosslessIntra.hpp"
+#include "../../../io/Rice.hpp"
+#include "../../../io/SpeculativeGolomb.hpp"
 #include "../../../visual/Video.hpp"
 
 using namespace std;
@@ -10,44 +12,106 @@ LosslessIntraEncoder::LosslessIntraEncoder(const char *src, const char *dst) : s
 LosslessIntraEncoder::LosslessIntraEncoder(const char *src) : src(src) {}
 
 void LosslessIntraEncoder::encode() {
-    BitStream bs(dst, ios::out);
-    Golomb g(&bs);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     const auto vid = Video(src);
     const vector<Frame *> frames = vid.generate_frames();
-#pragma omp parallel for default(none) shared(frames)
-    for (auto &frame: frames) { frame->encode_JPEG_LS(); }
-    if (golomb_m == 0) {
-        // Best m
-        double sum = 0;
-        const auto sample_f = sample_frames(frames, sample_factor);
-        for (auto &frame: sample_f) { sum += Golomb::adjust_m(frame->get_intra_encoding()); }
-        const int k = static_cast<int>(sum / static_cast<double>(sample_f.size()));
-        const int golomb_m = 1 << k;
-        this->golomb_m = golomb_m;
-    }
-    g.set_m(golomb_m);
-    // Write header
+    // Write header, m = 0 signals LOCO-I contexts with a per-pixel Golomb parameter
+    // With a block coder m is ignored, every frame is coded on its own
     const Frame sample = *frames[0];
     header.extract_info(sample);
     header.golomb_m = golomb_m;
+    header.golomb_limit = golomb_m == 0 ? 0 : Golomb::DEFAULT_LIMIT;
+    header.entropy_coder = entropy_coder;
+    // Only fixed Golomb codes are independent of the rows above, LOCO-I and block coders adapt across the frame
+    header.wavefront = wavefront && golomb_m != 0 && entropy_coder == GOLOMB;
+    // LOCO-I contexts adapt across the whole frame, and rows coded on their own need no slices or tiles
+    const bool sliced = !header.wavefront && (golomb_m != 0 || entropy_coder != GOLOMB);
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    const Slices frame_slices =
+            sliced ? Slices(width, height, min(slices, 255), min(tiles, 255)) : Slices(width, height, 1);
+    header.slices = frame_slices.slices();
+    header.tiles = frame_slices.tiles();
+    // The predictors of the blocks are only written ahead of a frame coded in a single Golomb stream
+    header.block_predictors = block_predictors && golomb_m != 0 && entropy_coder == GOLOMB && !header.wavefront &&
+                              frame_slices.count() == 1;
+    // The residuals of BGR frames are decorrelated with YCoCg-R, LOCO-I models the channels on its own
+    header.color_transform = color_transform && header.color_space == BGR && (golomb_m != 0 || entropy_coder != GOLOMB);
     header.fps_num = vid.get_header().fps_num;
     header.fps_den = vid.get_header().fps_den;
     header.length = frames.size();
     header.write_header(bs);
-    for (auto &frame: frames) { frame->write_JPEG_LS(g); }
+    // Each frame is coded into its own buffer in parallel, and the buffers are spliced in order as they are done
+    const int m = golomb_m;
+    const int limit = header.golomb_limit;
+    const ENTROPY_CODER coder = entropy_coder;
+    const bool rows = header.wavefront;
+    const GolombParameters parameters = GolombParameters::uniform(golomb_m);
+    const bool blocks = header.block_predictors;
+    const bool transform = header.color_transform;
+    encodeInOrder(
+            frames.size(),
+            [&](const size_t index, BitStream &stream) {
+                frames[index]->set_color_transform(transform);
+                if (rows) {
+                    frames[index]->encode_JPEG_LS_rows(stream, m, limit);
+                } else if (coder != GOLOMB || frame_slices.count() > 1) {
+                    frames[index]->encode_JPEG_LS(frame_slices);
+                    frames[index]->write_frame(stream, coder, parameters, limit, frame_slices);
+                } else if (m == 0) {
+                    frames[index]->encode_LOCO_I(stream);
+                } else if (blocks) {
+                    withGolombCoder(&stream, m, limit, [&frames, &stream, index](const auto &g) {
+                        frames[index]->encode_intra_blocks(g, stream);
+                    });
+                } else {
+                    // The residuals are written as they are predicted, so they are never kept
+                    withGolombCoder(&stream, m, limit, [&frames, index](const auto &g) {
+                        frames[index]->encode_JPEG_LS(g);
+                    });
+                }
+            },
+            [&bs](BitStream &stream) { bs.append(stream); });
+    close_output(bs);
 }
 
 void LosslessIntraEncoder::decode() {
     BitStream bs(src, ios::in);
-    Golomb golomb(&bs);
     header = Header::read_header(bs);
-    golomb.set_m(header.golomb_m);
-    for (int i = 0; i < header.length; i++) {
-        Frame img = Frame::decode_JPEG_LS(golomb, header);
-        frames.push_back(img);
+    const Slices frame_slices(static_cast<int>(header.width), static_cast<int>(header.height), header.slices,
+                              header.tiles);
+    if (header.entropy_coder != GOLOMB || frame_slices.count() > 1) {
+        // Every tile of a frame is decoded on its own thread, with coders of its own
+        InterHeader frame_header(header);
+        frame_header.golomb_parameters = GolombParameters::uniform(header.golomb_m);
+        for (uint32_t i = 0; i < header.length; i++) {
+            Frame frame = Frame::read_frame(bs, frame_header, frame_slices, nullptr);
+            frame.setType(I_FRAME);
+            frames.push_back(frame);
+        }
+    } else if (header.golomb_m == 0) {
+        for (uint32_t i = 0; i < header.length; i++) { frames.push_back(Frame::decode_LOCO_I(bs, header)); }
+    } else if (header.wavefront) {
+        for (uint32_t i = 0; i < header.length; i++) { frames.push_back(Frame::decode_JPEG_LS_rows(bs, header)); }
+    } else if (speculative_threads > 1) {
+        // Golomb codes with a power of two m are Rice codes, so every stream can be decoded this way
+        SpeculativeGolomb golomb(&bs, header.golomb_m, header.golomb_limit, speculative_threads);
+        for (uint32_t i = 0; i < header.length; i++) {
+            frames.push_back(header.block_predictors ? Frame::decode_intra_blocks(golomb, bs, header)
+                                                     : Frame::decode_JPEG_LS(golomb, header));
+        }
+    } else {
+        withGolombCoder(&bs, header.golomb_m, header.golomb_limit, [this, &bs](auto &golomb) {
+            for (uint32_t i = 0; i < header.length; i++) {
+                Frame img = header.block_predictors ? Frame::decode_intra_blocks(golomb, bs, header)
+                                                    : Frame::decode_JPEG_LS(golomb, header);
+                frames.push_back(img);
+            }
+        });
     }
     if (dst != nullptr) {
         Video vid(frames);
         vid.save_y4m(dst, header);
     }
-}
\ No newline at end of file
+}
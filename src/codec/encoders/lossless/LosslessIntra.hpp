@@ -16,14 +16,14 @@ public:
     const char *src{};
     const char *dst{};
     uint8_t golomb_m = 0;
+    int speculative_threads = 0;//!< Threads decoding each frame speculatively, only used with a fixed Golomb m
     Header header{};
-    int sample_factor = 100;
 
     /**
      * \brief Constructor for the LosslessIntraFrameEncoder class
      * \param src File path of the input video
      * \param dst File path to write encoded video
-     * \param golomb_m Golomb m parameter
+     * \param golomb_m Golomb m parameter, 0 to adapt it to every pixel with LOCO-I contexts
      */
     LosslessIntraEncoder(const char *src, const char *dst, uint8_t golomb_m);
     /**
@@ -15,7 +15,8 @@ DCTEncoder::DCTEncoder(const char *src, const char *dst, const uint8_t golomb_m)
 DCTEncoder::DCTEncoder(const char *src, const char *dst) : src(src), dst(dst), golomb_m(0), block_size(0) {}
 
 void DCTEncoder::encode() {
-    BitStream bs(dst, ios::out);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     Golomb g(&bs);
     Video vid(src);
     const vector<Frame *> frames = vid.generate_frames();
@@ -30,10 +31,11 @@ void DCTEncoder::encode() {
     for (Image img: vid.get_reel()) {
         encode_frame(&img, &g);
     }
+    close_output(bs);
 }
 
 void DCTEncoder::encode_frame(Image *im, Golomb *g) {
-    RLEEncoder rle(g);
+    RLEEncoder<Golomb> rle(g);
     Mat *image_mat = im->get_image_mat();
 
     //for each channel
@@ -46,7 +48,7 @@ void DCTEncoder::encode_frame(Image *im, Golomb *g) {
                 //copy the block to a 8x8 int matrix
                 for (int br = 0; br < 8; br++) {
                     for (int bc = 0; bc < 8; bc++) {
-                        block[br][bc] = image_mat->at<Vec3b>(row + br, col + bc)[channel];
+                        block[br][bc] = image_mat->ptr<uchar>(row + br)[(col + bc) * image_mat->channels() + channel];
                     }
                 }
                 //get the dct of it into dct_matrix
@@ -112,19 +114,19 @@ void DCTEncoder::decode() {
     header = InterHeader::read_header(bs);
 
     g.set_m(header.golomb_m);
-    RLEEncoder rle(&g);
+    RLEEncoder<Golomb> rle(&g);
 
     int rows = header.width;
     int cols = header.height;
     CHROMA_SUBSAMPLING cs = header.chroma_subsampling;
     COLOR_SPACE color = header.color_space;
 
-    for (int i = 0; i < header.length; i++) {
+    for (uint32_t i = 0; i < header.length; i++) {
         frames.push_back(decode_frame(&rle, &header));
     }
 }
 
-Frame DCTEncoder::decode_frame(RLEEncoder *rle, Header *h) const {
+Frame DCTEncoder::decode_frame(RLEEncoder<Golomb> *rle, Header *h) const {
     Image im;
     const int rows = header.height;
     const int cols = header.width;
@@ -167,7 +169,7 @@ Frame DCTEncoder::decode_frame(RLEEncoder *rle, Header *h) const {
                 //put the block into mat
                 for (int br = 0; br < 8; br++) {
                     for (int bc = 0; bc < 8; bc++) {
-                        mat.at<Vec3b>(row + br, col + bc)[channel] = block[br][bc];
+                        mat.ptr<uchar>(row + br)[(col + bc) * mat.channels() + channel] = static_cast<uchar>(block[br][bc]);
                     }
                 }
             }
@@ -109,7 +109,7 @@ public:
     void decode() override;
 
     void encode_frame(Image *im, Golomb *g);
-    Frame decode_frame(RLEEncoder *rle, Header *h) const;
+    Frame decode_frame(RLEEncoder<Golomb> *rle, Header *h) const;
 
     static void dct8x8(int (&in)[8][8], double (&out)[8][8]);
     static void idct8x8(double (&in)[8][8], int (&out)[8][8]);
@@ -1,19 +1,12 @@
 #include "LossyHybrid.hpp"
+#include "../../../io/Rice.hpp"
+#include "../../MedKernel.hpp"
 #include "../../Quantizer.hpp"
 
 using namespace std;
 using namespace cv;
 
-LossyHybridHeader::LossyHybridHeader(const Header &header) : InterHeader() {
-    this->color_space = header.color_space;
-    this->chroma_subsampling = header.chroma_subsampling;
-    this->height = header.height;
-    this->width = header.width;
-    this->golomb_m = header.golomb_m;
-    this->length = header.length;
-    this->fps_num = header.fps_num;
-    this->fps_den = header.fps_den;
-}
+LossyHybridHeader::LossyHybridHeader(const Header &header) : InterHeader(header) {}
 
 void LossyHybridHeader::write_header(BitStream &bs) const {
     Header::write_header(bs);
@@ -23,6 +16,7 @@ void LossyHybridHeader::write_header(BitStream &bs) const {
     bs.writeBits(y, 8);
     bs.writeBits(u, 8);
     bs.writeBits(v, 8);
+    golomb_parameters.write(bs);
 }
 
 LossyHybridHeader LossyHybridHeader::read_header(BitStream &bs) {
@@ -33,6 +27,7 @@ LossyHybridHeader LossyHybridHeader::read_header(BitStream &bs) {
     header.y = bs.readBits(8);
     header.u = bs.readBits(8);
     header.v = bs.readBits(8);
+    header.golomb_parameters = GolombParameters::read(bs);
     return header;
 }
 
@@ -71,67 +66,106 @@ LossyHybridEncoder::LossyHybridEncoder(const char *src, const char *dst)
 }
 
 void LossyHybridEncoder::encode() {
-    BitStream bs(dst, ios::out);
-    Golomb g(&bs);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     const Video vid(src);
     const vector<Frame *> frames = vid.generate_frames();
     const Frame sample = *frames[0];
-    header.extract_info(sample);
-    header.golomb_m = golomb_m;
-    header.length = frames.size();
-    header.block_size = block_size;
-    header.period = period;
-    header.search_radius = search_radius;
-    header.y = y;
-    header.u = u;
-    header.v = v;
-    header.write_header(bs);
-    g.set_m(golomb_m);
+    // Slices and tiles are made of whole blocks, so that intra and inter frames are split alike
+    const Slices frame_slices(sample.get_image().size().width, sample.get_image().size().height, min(slices, 255),
+                              min(tiles, 255), block_size);
     int cnt = period;
     int last_intra = 0;
-    for (int index = 0; index < frames.size(); index++) {
+    vector<Frame *> intra_frames;
+    vector<Frame *> inter_frames;
+    for (size_t index = 0; index < frames.size(); index++) {
         Frame *frame = frames[index];
         if (cnt == period) {
-            encode_JPEG_LS(*frame);
+            encode_JPEG_LS(*frame, frame_slices);
+            intra_frames.push_back(frame);
             last_intra = index;
             cnt = 0;
         } else {
             const Frame *frame_intra = frames[last_intra];
-            frame->calculate_MV(*frame_intra, block_size, header.search_radius, true);
+            inter_frames.push_back(frame);
+            frame->calculate_MV(*frame_intra, block_size, search_radius, true);
             quantize_inter(*frame);
             cnt++;
         }
     }
-    for (const auto &frame: frames) {
-        if (frame->get_type() == I_FRAME) {
-            frame->write_JPEG_LS(g);
-        } else {
-            frame->write(g);
-        }
-    }
+    // Every class of syntax element gets its own m, picked from a sample of frames unless m was given
+    // The block coders fit their tables or probabilities to every frame, so they need no parameters
+    const GolombParameters parameters =
+            entropy_coder != GOLOMB || golomb_m != 0
+                    ? GolombParameters::uniform(golomb_m)
+                    : estimate_golomb_parameters(intra_frames, inter_frames, sample_factor);
+    header.extract_info(sample);
+    header.golomb_m = golomb_m;
+    header.golomb_limit = Golomb::DEFAULT_LIMIT;
+    header.entropy_coder = entropy_coder;
+    header.slices = frame_slices.slices();
+    header.tiles = frame_slices.tiles();
+    header.length = frames.size();
+    header.block_size = block_size;
+    header.period = period;
+    header.search_radius = search_radius;
+    header.y = y;
+    header.u = u;
+    header.v = v;
+    header.golomb_parameters = parameters;
+    header.write_header(bs);
+    // Each frame is written to its own buffer in parallel, and the buffers are spliced in order as they are done
+    const int limit = header.golomb_limit;
+    const ENTROPY_CODER coder = entropy_coder;
+    encodeInOrder(
+            frames.size(),
+            [&](const size_t index, BitStream &stream) {
+                frames[index]->write_frame(stream, coder, parameters, limit, frame_slices);
+            },
+            [&bs](BitStream &stream) { bs.append(stream); });
+    close_output(bs);
 }
 
 void LossyHybridEncoder::decode() {
     BitStream bs(src, ios::in);
-    Golomb g(&bs);
     header = LossyHybridHeader::read_header(bs);
     populate();
-    g.set_m(header.golomb_m);
+    // The tiles of every frame are decoded in parallel, the frames in order
+    const Slices frame_slices(static_cast<int>(header.width), static_cast<int>(header.height), header.slices,
+                              header.tiles, block_size);
+    const size_t blocks_per_row = header.width / block_size;
     int cnt = period;
     int last_intra = 0;
-    for (int index = 0; index < header.length; index++) {
+    for (uint32_t index = 0; index < header.length; index++) {
         if (cnt == period) {
-            frames.push_back(decode_intra(g));
+            Mat mat(static_cast<int>(header.height), static_cast<int>(header.width),
+                    header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+            readSlices(bs, header.entropy_coder, header.golomb_parameters, header.golomb_limit, frame_slices,
+                       [this, &mat, &frame_slices](auto &g, const int tile) {
+                           Mat columns = frame_slices.tile_columns(mat, tile);
+                           decode_intra(g, columns, frame_slices.begin(tile), frame_slices.end(tile));
+                       });
+            Image im(mat);
+            im.set_color(header.color_space);
+            im.set_chroma(header.chroma_subsampling);
+            Frame frame(im);
+            frame.setType(I_FRAME);
+            frames.push_back(frame);
             last_intra = index;
             cnt = 0;
         } else {
+            vector<MotionVector> mvs(blocks_per_row * (header.height / block_size));
+            readSlices(bs, header.entropy_coder, header.golomb_parameters, header.golomb_limit, frame_slices,
+                       [this, &mvs, &frame_slices, blocks_per_row](auto &g, const int tile) {
+                           frame_slices.unit_rows(tile, blocks_per_row,
+                                                  [this, &g, &mvs](const size_t begin, const size_t end) {
+                                                      decode_inter(g, mvs, begin, end);
+                                                  });
+                       });
             Frame frame_intra = frames[last_intra];
-            frames.push_back(decode_inter(g, frame_intra));
+            frames.push_back(Frame::reconstruct_frame(frame_intra, mvs, block_size));
             cnt++;
         }
-        Image im = frames[index].get_image();
-        im.set_color(header.color_space);
-        im.set_chroma(header.chroma_subsampling);
     }
     if (dst != nullptr) {
         Video vid(frames);
@@ -139,111 +173,93 @@ void LossyHybridEncoder::decode() {
     }
 }
 
-void LossyHybridEncoder::encode_JPEG_LS(Frame &frame) const {
-    vector<int> intra_encoding;
+void LossyHybridEncoder::encode_JPEG_LS(Frame &frame, const Slices &slices) const {
     frame.setType(I_FRAME);
     Mat image_mat_ = *frame.get_image().get_image_mat();
-    for (int r = 0; r < image_mat_.rows; r++) {
-        for (int c = 0; c < image_mat_.cols; c++) {
-            for (int channel = 0; channel < image_mat_.channels(); channel++) {
-                const int real = image_mat_.at<Vec3b>(r, c)[channel];
-                const int predicted = Frame::predict_JPEG_LS(image_mat_, r, c, channel);
-                const int diff = real - predicted;
-                Quantizer quant;
-                if (channel == 0) {
-                    quant = y_quant;
-                } else if (channel == 1) {
-                    quant = u_quant;
-                } else {
-                    quant = v_quant;
-                }
-                const int level = quant.get_level(diff);
-                const int quantized = quant.get_value(level);
-                intra_encoding.push_back(level);
-                image_mat_.at<Vec3b>(r, c)[channel] = predicted + quantized;
+    const size_t row_size = static_cast<size_t>(image_mat_.cols) * image_mat_.channels();
+    vector<int> intra_encoding(row_size * image_mat_.rows);
+    const array<const Quantizer *, 3> quantizers{&y_quant, &u_quant, &v_quant};
+    // Samples are predicted from the reconstructed ones, as the decoder will
+    withMedKernel(image_mat_.channels(), [&image_mat_, &intra_encoding, &quantizers, &slices, row_size](auto kernel) {
+        constexpr int channels = decltype(kernel)::CHANNELS;
+        for (int tile = 0; tile < slices.count(); tile++) {
+            Mat columns = slices.tile_columns(image_mat_, tile);
+            const size_t left = static_cast<size_t>(slices.left(tile)) * channels;
+            for (int r = slices.begin(tile); r < slices.end(tile); r++) {
+                uchar *row = columns.ptr<uchar>(r);
+                int *levels = intra_encoding.data() + left + r * row_size;
+                const uchar *above = r > slices.begin(tile) ? columns.ptr<uchar>(r - 1) : nullptr;
+                kernel.reconstruct(row, above, columns.cols, [row, levels, &quantizers](const int i, const int predicted) {
+                    const Quantizer &quant = *quantizers[i % channels];
+                    levels[i] = quant.get_level(row[i] - predicted);
+                    return static_cast<uchar>(predicted + quant.get_value(levels[i]));
+                });
             }
         }
-    }
+    });
     frame.set_intra_encoding(intra_encoding);
 }
 
 void LossyHybridEncoder::quantize_inter(const Frame &frame) const {
+    const array<const Quantizer *, 3> quantizers{&y_quant, &u_quant, &v_quant};
     for (auto &mv: frame.get_motion_vectors()) {
-        mv.residual.forEach<Vec3s>([&](Vec3s &pixel, const int *) -> void {
-            pixel[0] = static_cast<short>(y_quant.get_level(pixel[0]));
-            pixel[1] = static_cast<short>(u_quant.get_level(pixel[1]));
-            pixel[2] = static_cast<short>(v_quant.get_level(pixel[2]));
-        });
+        const int channels = mv.residual.channels();
+        for (int r = 0; r < mv.residual.rows; r++) {
+            auto *sample = mv.residual.ptr<int16_t>(r);
+            for (int i = 0; i < mv.residual.cols * channels; i++) {
+                sample[i] = static_cast<int16_t>(quantizers[i % channels]->get_level(sample[i]));
+            }
+        }
     }
 }
 
-Frame LossyHybridEncoder::decode_intra(Golomb &g) const {
-    const int width = static_cast<int>(header.width);
-    const int height = static_cast<int>(header.height);
-    Mat mat(height, width, CV_8UC3);
-    for (int r = 0; r < mat.rows; r++) {
-        for (int c = 0; c < mat.cols; c++) {
-            for (int channel = 0; channel < mat.channels(); channel++) {
-                Quantizer quantizer;
-                if (channel == 0) {
-                    quantizer = y_quant;
-                } else if (channel == 1) {
-                    quantizer = u_quant;
-                } else {
-                    quantizer = v_quant;
-                }
-                const auto diff = quantizer.get_value(g.decode());
-                const uchar predicted = Frame::predict_JPEG_LS(mat, r, c, channel);
-                const uchar real = diff + predicted;
-                if (mat.channels() > 1) {
-                    mat.at<Vec3b>(r, c)[channel] = real;
-                } else {
-                    mat.at<uchar>(r, c) = real;
-                }
-            }
+template<typename Coders>
+void LossyHybridEncoder::decode_intra(Coders &g, Mat &mat, const int begin, const int end) const {
+    vector<int> levels(static_cast<size_t>(mat.cols) * mat.channels());
+    vector<int> line(mat.cols);
+    for (int r = begin; r < end; r++) {
+        // Each channel of the row was written on its own
+        for (int channel = 0; channel < mat.channels(); channel++) {
+            g.intra[channel].decode_span(line.data(), line.size());
+            for (int c = 0; c < mat.cols; c++) { levels[c * mat.channels() + channel] = line[c]; }
         }
+        const uchar *above = r > begin ? mat.ptr<uchar>(r - 1) : nullptr;
+        withMedKernel(mat.channels(), [this, &mat, &levels, r, above](auto kernel) {
+            constexpr int channels = decltype(kernel)::CHANNELS;
+            kernel.reconstruct(mat.ptr<uchar>(r), above, mat.cols, [this, &levels](const int i, const int predicted) {
+                const Quantizer &quant = i % channels == 0 ? y_quant : i % channels == 1 ? u_quant : v_quant;
+                return static_cast<uchar>(predicted + quant.get_value(levels[i]));
+            });
+        });
     }
-    Image im(mat);
-    im.set_color(header.color_space);
-    im.set_chroma(header.chroma_subsampling);
-    Frame frame(im);
-    frame.setType(I_FRAME);
-    return frame;
 }
 
-Frame LossyHybridEncoder::decode_inter(Golomb &g, Frame &frame_intra) const {
-    vector<MotionVector> mvs;
-    const int rows = static_cast<int>(header.height);
-    const int cols = static_cast<int>(header.width);
-    for (int block_num = 0; block_num < (rows / block_size) * (cols / block_size); block_num++) {
-        MotionVector mv;
-        Mat residual;
-        if (header.color_space == GRAY) {
-            residual = Mat::zeros(block_size, block_size, CV_16SC1);
-        } else {
-            residual = Mat::zeros(block_size, block_size, CV_16SC3);
-        }
-        mv.x = g.decode();
-        mv.y = g.decode();
-        for (int row = 0; row < block_size; row++) {
-            for (int col = 0; col < block_size; col++) {
-                for (int channel = 0; channel < residual.channels(); channel++) {
-                    Quantizer quantizer;
-                    if (channel == 0) {
-                        quantizer = y_quant;
-                    } else if (channel == 1) {
-                        quantizer = u_quant;
-                    } else {
-                        quantizer = v_quant;
-                    }
-                    residual.at<Vec3s>(row, col)[channel] = static_cast<short>(quantizer.get_value(g.decode()));
-                }
+template<typename Coders>
+void LossyHybridEncoder::decode_inter(Coders &g, vector<MotionVector> &mvs, const size_t begin, const size_t end) const {
+    const int channels = header.color_space == GRAY ? 1 : 3;
+    vector<int> values(static_cast<size_t>(block_size) * block_size);
+    for (size_t block = begin; block < end; block++) {
+        MotionVector &mv = mvs[block];
+        mv.x = g.mv_x.decode();
+        mv.y = g.mv_y.decode();
+        Mat residual = Mat::zeros(block_size, block_size, CV_MAKETYPE(CV_16S, channels));
+        auto *pixel = residual.ptr<int16_t>();
+        for (int channel = 0; channel < channels; channel++) {
+            g.inter[channel].decode_span(values.data(), values.size());
+            Quantizer quantizer;
+            if (channel == 0) {
+                quantizer = y_quant;
+            } else if (channel == 1) {
+                quantizer = u_quant;
+            } else {
+                quantizer = v_quant;
+            }
+            for (size_t i = 0; i < values.size(); i++) {
+                pixel[i * channels + channel] = static_cast<int16_t>(quantizer.get_value(values[i]));
             }
         }
         mv.residual = residual;
-        mvs.push_back(mv);
     }
-    return Frame::reconstruct_frame(frame_intra, mvs, block_size);
 }
 
 void LossyHybridEncoder::populate() {
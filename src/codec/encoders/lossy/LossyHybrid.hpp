@@ -44,7 +44,8 @@ public:
     const char *src{};         ///< File path of the input video
     const char *dst{};         ///< File path of the encoded video
     LossyHybridHeader header{};///< Header object
-    uint8_t golomb_m;          ///< Golomb m parameter
+    uint8_t golomb_m;          ///< Golomb m parameter, 0 to pick one per syntax element
+    int sample_factor = 100;   ///< Sample factor for picking the golomb parameters
     uint8_t block_size;        ///< Macroblock size
     uint8_t search_radius;     ///< Search radius
     uint8_t period;            ///< Period of intra frames
@@ -66,9 +67,10 @@ public:
     /**
      * \brief Encodes a frame using intra prediction, quantizing the differences
      * \param frame Frame to encode
+     * \param slices Slices and tiles of the frame, each tile is predicted as if it were a frame of its own
      * \details Prediction results are stored in the frame.intra_encodings vector
      */
-    void encode_JPEG_LS(Frame &frame) const;
+    void encode_JPEG_LS(Frame &frame, const Slices &slices) const;
 
     /**
      * \brief Quantizes motion vectors' residuals
@@ -77,19 +79,26 @@ public:
     void quantize_inter(const Frame &frame) const;
 
     /**
-     * \brief Decodes a frame using intra prediction, dequantizing the differences
-     * \param g Golomb decoder
-     * \return Decoded frame
+     * \brief Decodes some rows of a frame using intra prediction, dequantizing the differences
+     * \tparam Coders GolombCoders or BlockCoders
+     * \param g decoders
+     * \param mat Frame being decoded, or the columns of a tile of it
+     * \param begin First row to decode, predicted as the first row of a frame
+     * \param end Row after the last one to decode
      */
-    Frame decode_intra(Golomb &g) const;
+    template<typename Coders>
+    void decode_intra(Coders &g, cv::Mat &mat, int begin, int end) const;
 
     /**
-     * \brief Decodes a frame using inter prediction, dequantizing the residuals
-     * \param g Golomb decoder
-     * \param frame_intra Intra frame to use for reference
-     * \return Decoded frame
+     * \brief Decodes the motion vectors of some blocks, dequantizing the residuals
+     * \tparam Coders GolombCoders or BlockCoders
+     * \param g decoders
+     * \param mvs Motion vectors of the frame, the ones of the blocks are stored in place
+     * \param begin Index of the first block to decode
+     * \param end Index of the block after the last one to decode
      */
-    Frame decode_inter(Golomb &g, Frame &frame_intra) const;
+    template<typename Coders>
+    void decode_inter(Coders &g, std::vector<MotionVector> &mvs, size_t begin, size_t end) const;
 
     /**
      * \brief Populates encoder with data from header
@@ -1,19 +1,66 @@
 #include "LossyIntra.hpp"
+#include "../../../io/Cabac.hpp"
+#include "../../../io/Rice.hpp"
+#include "../../MedKernel.hpp"
 #include "../../Quantizer.hpp"
+#include "../../RunMode.hpp"
+#include "../../Wavefront.hpp"
 
 using namespace std;
 using namespace cv;
 
-LossyIntraHeader::LossyIntraHeader(const Header &header) : Header() {
-    this->color_space = header.color_space;
-    this->chroma_subsampling = header.chroma_subsampling;
-    this->height = header.height;
-    this->width = header.width;
-    this->golomb_m = header.golomb_m;
-    this->length = header.length;
-    this->fps_num = header.fps_num;
-    this->fps_den = header.fps_den;
-}
+namespace {
+    //! Whether the reconstructed neighbourhood of a sample is flat enough to start a run, top being the first row of
+    //! its tile and mat its columns
+    bool is_flat(const Mat &mat, const int top, const int row, const int col, const int channel, const int near) {
+        if (row == top || col == 0) { return false; }
+        const int channels = mat.channels();
+        const uchar *above = mat.ptr<uchar>(row - 1);
+        const int a = mat.ptr<uchar>(row)[(col - 1) * channels + channel];
+        const int b = above[col * channels + channel];
+        const int c = above[(col - 1) * channels + channel];
+        const int d = col + 1 < mat.cols ? above[(col + 1) * channels + channel] : b;
+        return abs(d - b) <= near && abs(b - c) <= near && abs(c - a) <= near;
+    }
+
+    //! Codes the levels with a Golomb coder and the run lengths with RunMode, both into the coder's stream
+    template<typename Coder>
+    class GolombIntraCoder {
+        Coder &g;                  ///< Golomb or Rice coder
+        std::vector<RunMode> runs; ///< run length coder of each channel
+
+    public:
+        explicit GolombIntraCoder(Coder &g) : g(g), runs(3) {}
+        void encode(int, const int level) { g.encode(level); }
+        void encode_run(const int channel, const int count, const int remaining) {
+            runs[channel].encode(*g.get_bs(), count, remaining);
+        }
+        int decode(int) { return g.decode(); }
+        int decode_run(const int channel, const int remaining) { return runs[channel].decode(*g.get_bs(), remaining); }
+    };
+
+    //! Codes the levels and the run lengths of each channel with Cabac coders of their own
+    class CabacIntraCoder {
+        std::array<Cabac, 3> levels;///< levels of each channel
+        std::array<Cabac, 3> runs;  ///< run lengths of each channel, a run reaching the end of the line codes its length
+
+    public:
+        void encode(const int channel, const int level) { levels[channel].encode(level); }
+        void encode_run(const int channel, const int count, int) { runs[channel].encode(count); }
+        int decode(const int channel) { return levels[channel].decode(); }
+        int decode_run(const int channel, int) { return runs[channel].decode(); }
+        void write(BitStream &bs) {
+            for (auto &coder: levels) { coder.write(bs); }
+            for (auto &coder: runs) { coder.write(bs); }
+        }
+        void read(BitStream &bs) {
+            for (auto &coder: levels) { coder.read(bs); }
+            for (auto &coder: runs) { coder.read(bs); }
+        }
+    };
+}// namespace
+
+LossyIntraHeader::LossyIntraHeader(const Header &header) : Header(header) {}
 
 void LossyIntraHeader::write_header(BitStream &bs) const {
     Header::write_header(bs);
@@ -50,42 +97,85 @@ LossyIntraEncoder::LossyIntraEncoder(const char *src) : golomb_m(0), y_quant(),
 }
 
 void LossyIntraEncoder::encode() {
-    BitStream bs(dst, ios::out);
-    Golomb g(&bs);
+    const unique_ptr<BitStream> output = open_output(dst);
+    BitStream &bs = *output;
     const auto vid = Video(src);
     const vector<Frame *> frames = vid.generate_frames();
-#pragma omp parallel for default(none) shared(frames)
-    for (auto &frame: frames) {
-        encode_JPEG_LS(*frame);
-    }
-    g.set_m(golomb_m);
     // Write header
     const Frame sample = *frames[0];
     header.extract_info(sample);
     header.golomb_m = golomb_m;
+    header.golomb_limit = Golomb::DEFAULT_LIMIT;
+    header.entropy_coder = entropy_coder;
+    header.wavefront = wavefront;
+    // Rows coded on their own are already as independent as slices and tiles can be
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    const Slices frame_slices =
+            wavefront ? Slices(width, height, 1) : Slices(width, height, min(slices, 255), min(tiles, 255));
+    header.slices = frame_slices.slices();
+    header.tiles = frame_slices.tiles();
     header.length = frames.size();
     header.y = y;
     header.u = u;
     header.v = v;
     header.write_header(bs);
-    for (auto &frame: frames) {
-        frame->write_JPEG_LS(g);
-    }
+    // Each frame is coded into its own buffer in parallel, and the buffers are spliced in order as they are done
+    const int m = golomb_m;
+    const int limit = header.golomb_limit;
+    const bool cabac = entropy_coder == CABAC;
+    const bool rows = wavefront;
+    encodeInOrder(
+            frames.size(),
+            [&](const size_t index, BitStream &stream) {
+                if (rows) {
+                    encode_intra_rows(*frames[index], stream);
+                } else if (frame_slices.count() > 1) {
+                    encode_intra_slices(*frames[index], stream, frame_slices);
+                } else if (cabac) {
+                    CabacIntraCoder coder;
+                    encode_intra(*frames[index], coder);
+                    coder.write(stream);
+                } else {
+                    withGolombCoder(&stream, m, limit, [this, &frames, index](const auto &g) {
+                        GolombIntraCoder<decltype(g)> coder(g);
+                        encode_intra(*frames[index], coder);
+                    });
+                }
+            },
+            [&bs](BitStream &stream) { bs.append(stream); });
+    close_output(bs);
 }
 
 void LossyIntraEncoder::decode() {
     BitStream bs(src, ios::in);
-    Golomb golomb(&bs);
     header = LossyIntraHeader::read_header(bs);
     golomb_m = header.golomb_m;
     y = header.y;
     u = header.u;
     v = header.v;
     initialize_quantizers();
-    golomb.set_m(golomb_m);
-    for (int i = 0; i < header.length; i++) {
-        Frame img = decode_intra(golomb);
-        frames.push_back(img);
+    const Slices frame_slices(static_cast<int>(header.width), static_cast<int>(header.height), header.slices,
+                              header.tiles);
+    if (header.wavefront) {
+        for (uint32_t i = 0; i < header.length; i++) { frames.push_back(decode_intra_rows(bs)); }
+    } else if (frame_slices.count() > 1) {
+        for (uint32_t i = 0; i < header.length; i++) { frames.push_back(decode_intra_slices(bs, frame_slices)); }
+    } else if (header.entropy_coder == CABAC) {
+        CabacIntraCoder coder;
+        for (uint32_t i = 0; i < header.length; i++) {
+            coder.read(bs);
+            frames.push_back(decode_intra(coder));
+        }
+    } else {
+        withGolombCoder(&bs, golomb_m, header.golomb_limit, [this](auto &golomb) {
+            for (uint32_t i = 0; i < header.length; i++) {
+                // Every frame starts with fresh run length coders, as it was encoded on its own
+                GolombIntraCoder<decltype(golomb)> coder(golomb);
+                Frame img = decode_intra(coder);
+                frames.push_back(img);
+            }
+        });
     }
     if (dst != nullptr) {
         Video vid(frames);
@@ -93,60 +183,173 @@ void LossyIntraEncoder::decode() {
     }
 }
 
-void LossyIntraEncoder::encode_JPEG_LS(Frame &frame) const {
-    vector<int> intra_encoding;
+template<typename Coder>
+void LossyIntraEncoder::encode_intra(Frame &frame, Coder &coder) const {
+    frame.setType(I_FRAME);
+    Mat image_mat_ = *frame.get_image().get_image_mat();
+    for (int r = 0; r < image_mat_.rows; r++) { encode_row(image_mat_, 0, r, coder); }
+}
+
+void LossyIntraEncoder::encode_intra_rows(Frame &frame, BitStream &bs) const {
     frame.setType(I_FRAME);
     Mat image_mat_ = *frame.get_image().get_image_mat();
+    // Every row has its own coders, so it can be decoded without the rows above being decoded first
+    vector<BitStream> rows(image_mat_.rows);
     for (int r = 0; r < image_mat_.rows; r++) {
-        for (int c = 0; c < image_mat_.cols; c++) {
-            for (int channel = 0; channel < image_mat_.channels(); channel++) {
-                const int real = image_mat_.at<Vec3b>(r, c)[channel];
-                const int predicted = Frame::predict_JPEG_LS(image_mat_, r, c, channel);
-                const int diff = real - predicted;
-                Quantizer quant;
-                if (channel == 0) {
-                    quant = y_quant;
-                } else if (channel == 1) {
-                    quant = u_quant;
-                } else {
-                    quant = v_quant;
-                }
-                const int level = quant.get_level(diff);
-                const int quantized = quant.get_value(level);
-                intra_encoding.push_back(level);
-                image_mat_.at<Vec3b>(r, c)[channel] = predicted + quantized;
-            }
+        if (entropy_coder == CABAC) {
+            CabacIntraCoder coder;
+            encode_row(image_mat_, 0, r, coder);
+            coder.write(rows[r]);
+        } else {
+            withGolombCoder(&rows[r], golomb_m, Golomb::DEFAULT_LIMIT, [this, &image_mat_, r](const auto &g) {
+                GolombIntraCoder<decltype(g)> coder(g);
+                encode_row(image_mat_, 0, r, coder);
+            });
         }
     }
-    frame.set_intra_encoding(intra_encoding);
+    Substreams::write(bs, rows);
 }
 
-Frame LossyIntraEncoder::decode_intra(Golomb &g) const {
-    const int width = static_cast<int>(header.width);
-    const int height = static_cast<int>(header.height);
-    Mat mat(height, width, CV_8UC3);
-    for (int r = 0; r < mat.rows; r++) {
-        for (int c = 0; c < mat.cols; c++) {
-            for (int channel = 0; channel < mat.channels(); channel++) {
-                Quantizer quantizer;
-                if (channel == 0) {
-                    quantizer = y_quant;
-                } else if (channel == 1) {
-                    quantizer = u_quant;
-                } else {
-                    quantizer = v_quant;
+void LossyIntraEncoder::encode_intra_slices(Frame &frame, BitStream &bs, const Slices &slices) const {
+    frame.setType(I_FRAME);
+    Mat image_mat_ = *frame.get_image().get_image_mat();
+    // A tile only reads its own samples, so the tiles can be reconstructed in place at the same time
+    vector<BitStream> parts(slices.count());
+    slices.run([this, &image_mat_, &parts, &slices](const int tile) {
+        // The columns of the tile are coded as a frame of their own, their first column as the first one of a frame
+        Mat columns = slices.tile_columns(image_mat_, tile);
+        const int top = slices.begin(tile);
+        if (entropy_coder == CABAC) {
+            CabacIntraCoder coder;
+            for (int r = top; r < slices.end(tile); r++) { encode_row(columns, top, r, coder); }
+            coder.write(parts[tile]);
+        } else {
+            withGolombCoder(&parts[tile], golomb_m, Golomb::DEFAULT_LIMIT, [&](const auto &g) {
+                GolombIntraCoder<decltype(g)> coder(g);
+                for (int r = top; r < slices.end(tile); r++) { encode_row(columns, top, r, coder); }
+            });
+        }
+    });
+    Substreams::write(bs, parts);
+}
+
+template<typename Coder>
+void LossyIntraEncoder::encode_row(Mat &image_mat_, const int top, const int r, Coder &coder) const {
+    const int channels = image_mat_.channels();
+    const int cols = image_mat_.cols;
+    uchar *row = image_mat_.ptr<uchar>(r);
+    const uchar *above = r > top ? image_mat_.ptr<uchar>(r - 1) : nullptr;
+    withMedKernel(channels, [this, &image_mat_, &coder, top, r, row, above, channels, cols](auto kernel) {
+        for (int channel = 0; channel < channels; channel++) {
+            const Quantizer &quant = channel == 0 ? y_quant : channel == 1 ? u_quant : v_quant;
+            // A run tolerates the same error as the quantizer
+            const int near = quant.get_value(1) / 2;
+            for (int c = 0; c < cols; c++) {
+                if (is_flat(image_mat_, top, r, c, channel, near)) {
+                    const uchar value = row[(c - 1) * channels + channel];
+                    int count = 0;
+                    while (c + count < cols && abs(row[(c + count) * channels + channel] - value) <= near) {
+                        row[(c + count) * channels + channel] = value;
+                        count++;
+                    }
+                    coder.encode_run(channel, count, cols - c);
+                    c += count;
+                    if (c == cols) { break; }
                 }
-                const auto diff = quantizer.get_value(g.decode());
-                const uchar predicted = Frame::predict_JPEG_LS(mat, r, c, channel);
-                const uchar real = diff + predicted;
-                if (mat.channels() > 1) {
-                    mat.at<Vec3b>(r, c)[channel] = real;
-                } else {
-                    mat.at<uchar>(r, c) = real;
+                const int real = row[c * channels + channel];
+                const int predicted = kernel.predict(row, above, c, channel);
+                const int level = quant.get_level(real - predicted);
+                coder.encode(channel, level);
+                row[c * channels + channel] = static_cast<uchar>(predicted + quant.get_value(level));
+            }
+        }
+    });
+}
+
+template<typename Coder>
+Frame LossyIntraEncoder::decode_intra(Coder &coder) const {
+    Mat mat(static_cast<int>(header.height), static_cast<int>(header.width),
+            header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    for (int r = 0; r < mat.rows; r++) { decode_row(mat, 0, r, coder, nullptr); }
+    return intra_frame(mat);
+}
+
+Frame LossyIntraEncoder::decode_intra_rows(BitStream &bs) const {
+    Mat mat(static_cast<int>(header.height), static_cast<int>(header.width),
+            header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    Substreams streams;
+    streams.read(bs, mat.rows);
+    Wavefront wavefront(mat.rows);
+    wavefront.run([this, &mat, &streams, &wavefront](const int r) {
+        BitStream in(streams.data(r), streams.size(r));
+        if (header.entropy_coder == CABAC) {
+            CabacIntraCoder coder;
+            coder.read(in);
+            decode_row(mat, 0, r, coder, &wavefront);
+        } else {
+            withGolombCoder(&in, golomb_m, header.golomb_limit, [this, &mat, r, &wavefront](auto &g) {
+                GolombIntraCoder<decltype(g)> coder(g);
+                decode_row(mat, 0, r, coder, &wavefront);
+            });
+        }
+    });
+    return intra_frame(mat);
+}
+
+Frame LossyIntraEncoder::decode_intra_slices(BitStream &bs, const Slices &slices) const {
+    Mat mat(static_cast<int>(header.height), static_cast<int>(header.width),
+            header.color_space == GRAY ? CV_8UC1 : CV_8UC3);
+    Substreams streams;
+    streams.read(bs, slices.count());
+    slices.run([this, &mat, &streams, &slices](const int tile) {
+        Mat columns = slices.tile_columns(mat, tile);
+        const int top = slices.begin(tile);
+        BitStream in(streams.data(tile), streams.size(tile));
+        if (header.entropy_coder == CABAC) {
+            CabacIntraCoder coder;
+            coder.read(in);
+            for (int r = top; r < slices.end(tile); r++) { decode_row(columns, top, r, coder, nullptr); }
+        } else {
+            withGolombCoder(&in, golomb_m, header.golomb_limit, [&](auto &g) {
+                GolombIntraCoder<decltype(g)> coder(g);
+                for (int r = top; r < slices.end(tile); r++) { decode_row(columns, top, r, coder, nullptr); }
+            });
+        }
+    });
+    return intra_frame(mat);
+}
+
+template<typename Coder>
+void LossyIntraEncoder::decode_row(Mat &mat, const int top, const int r, Coder &coder, Wavefront *wavefront) const {
+    const int width = mat.cols;
+    const int channels = mat.channels();
+    uchar *row = mat.ptr<uchar>(r);
+    const uchar *above = r > top ? mat.ptr<uchar>(r - 1) : nullptr;
+    withMedKernel(channels, [&](auto kernel) {
+        for (int channel = 0; channel < channels; channel++) {
+            const Quantizer &quant = channel == 0 ? y_quant : channel == 1 ? u_quant : v_quant;
+            const int near = quant.get_value(1) / 2;
+            for (int c = 0; c < width; c++) {
+                // A sample reads the row above up to the next column, progress counts the samples of every channel
+                if (wavefront != nullptr) { wavefront->wait(r - 1, channel * width + min(c + 2, width)); }
+                if (is_flat(mat, top, r, c, channel, near)) {
+                    const uchar value = row[(c - 1) * channels + channel];
+                    const int count = coder.decode_run(channel, width - c);
+                    for (int i = 0; i < count; i++) { row[(c + i) * channels + channel] = value; }
+                    c += count;
+                    if (c == width) { break; }
+                    if (wavefront != nullptr) { wavefront->wait(r - 1, channel * width + min(c + 2, width)); }
                 }
+                const int predicted = kernel.predict(row, above, c, channel);
+                row[c * channels + channel] = static_cast<uchar>(predicted + quant.get_value(coder.decode(channel)));
+                if (wavefront != nullptr) { wavefront->publish(r, channel * width + c + 1); }
             }
+            if (wavefront != nullptr) { wavefront->publish(r, (channel + 1) * width); }
         }
-    }
+    });
+}
+
+Frame LossyIntraEncoder::intra_frame(const Mat &mat) const {
     Image im(mat);
     im.set_color(header.color_space);
     im.set_chroma(header.chroma_subsampling);
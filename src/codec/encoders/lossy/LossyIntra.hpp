@@ -9,6 +9,7 @@
 #include "../../Encoder.hpp"
 #include "../../Header.hpp"
 #include "../../Quantizer.hpp"
+#include "../../Wavefront.hpp"
 
 class LossyIntraHeader : public Header {
 public:
@@ -56,9 +57,91 @@ public:
     void encode() override;
     void decode() override;
 
-    void encode_JPEG_LS(Frame &frame) const;
+    /**
+     * \brief Encodes a frame with quantized JPEG-LS prediction, switching to run mode in flat regions
+     * \details The frame is reconstructed as the decoder will see it, so that predictions match. Samples that differ
+     * from the run value by no more than the quantization error are coded as part of the run.
+     * \tparam Coder coder of the levels and of the run lengths of each channel, with Golomb codes or CABAC
+     * \param frame frame to encode
+     * \param coder coder writing to the frame's stream
+     */
+    template<typename Coder>
+    void encode_intra(Frame &frame, Coder &coder) const;
 
-    Frame decode_intra(Golomb &g) const;
+    /**
+     * \brief Decodes a frame written by encode_intra
+     * \tparam Coder coder of the levels and of the run lengths of each channel, with Golomb codes or CABAC
+     * \param coder coder reading from the stream
+     * \return decoded frame
+     */
+    template<typename Coder>
+    Frame decode_intra(Coder &coder) const;
+
+    /**
+     * \brief Encodes a frame as encode_intra does, but each row into a substream of its own, with coders of its own
+     * \details Run lengths and CABAC probabilities don't carry over from one row to the next, which costs some bits
+     * \param frame frame to encode
+     * \param bs BitStream to write the rows to (see Substreams)
+     */
+    void encode_intra_rows(Frame &frame, BitStream &bs) const;
+
+    /**
+     * \brief Decodes a frame written by encode_intra_rows, its rows on several threads (see Wavefront)
+     * \param bs BitStream to read the rows from
+     * \return decoded frame
+     */
+    Frame decode_intra_rows(BitStream &bs) const;
+
+    /**
+     * \brief Encodes a frame as encode_intra does, but each tile into a substream of its own, with coders of its own
+     * \details Every tile is predicted and run coded as if it were a frame of its own, and the tiles are encoded on
+     * several threads
+     * \param frame frame to encode
+     * \param bs BitStream to write the tiles to (see Substreams)
+     * \param slices slices and tiles of the frame
+     */
+    void encode_intra_slices(Frame &frame, BitStream &bs, const Slices &slices) const;
+
+    /**
+     * \brief Decodes a frame written by encode_intra_slices, its tiles on several threads
+     * \param bs BitStream to read the tiles from
+     * \param slices slices and tiles of the frame
+     * \return decoded frame
+     */
+    Frame decode_intra_slices(BitStream &bs, const Slices &slices) const;
 
     void initialize_quantizers();
+
+private:
+    /**
+     * \brief Encodes a row of a frame, the rows above being reconstructed already
+     * \tparam Coder coder of the levels and of the run lengths of each channel
+     * \param image_mat_ the frame or the columns of a tile of it, whose row is replaced by its reconstruction
+     * \param top first row of the tile of the row, which is predicted as the first row of a frame
+     * \param r the row
+     * \param coder coder writing the row
+     */
+    template<typename Coder>
+    void encode_row(cv::Mat &image_mat_, int top, int r, Coder &coder) const;
+
+    /**
+     * \brief Decodes a row of a frame
+     * \details When decoding in a wavefront, the progress published is the number of samples done, counting the
+     * channels one after the other
+     * \tparam Coder coder of the levels and of the run lengths of each channel
+     * \param mat the frame or the columns of a tile of it, whose row is decoded
+     * \param top first row of the tile of the row, which is predicted as the first row of a frame
+     * \param r the row
+     * \param coder coder reading the row
+     * \param wavefront wavefront the row is decoded in, nullptr if the rows are decoded in order
+     */
+    template<typename Coder>
+    void decode_row(cv::Mat &mat, int top, int r, Coder &coder, Wavefront *wavefront) const;
+
+    /**
+     * \brief Wraps a decoded matrix in an intra frame
+     * \param mat decoded matrix
+     * \return the frame
+     */
+    Frame intra_frame(const cv::Mat &mat) const;
 };
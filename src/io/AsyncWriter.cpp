@@ -0,0 +1,98 @@
+#include "AsyncWriter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+AsyncWriter::AsyncWriter(const string &filePath, const size_t depth) : depth(max<size_t>(depth, 1)) {
+    file = fopen(filePath.c_str(), "wb");
+    if (file == nullptr) {
+        throw runtime_error("File does not exist or can't be opened");
+    }
+    // Blocks are already large, stdio buffering would only add a copy
+    setvbuf(file, nullptr, _IONBF, 0);
+    worker = thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    notEmpty.notify_one();
+    worker.join();
+    fclose(file);
+}
+
+void AsyncWriter::run() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        notEmpty.wait(lock, [this] { return !pending.empty() || stopping; });
+        if (pending.empty()) return;// Stopping and nothing left to write
+        vector<uint8_t> block = std::move(pending.front());
+        const size_t size = pendingSizes.front();
+        pending.pop_front();
+        pendingSizes.pop_front();
+        inFlight++;
+        lock.unlock();
+        const bool ok = fwrite(block.data(), 1, size, file) == size;
+        lock.lock();
+        inFlight--;
+        failed = failed || !ok;
+        spare.push_back(std::move(block));
+        notFull.notify_all();
+    }
+}
+
+void AsyncWriter::submit(vector<uint8_t> &block, const size_t size) {
+    unique_lock<std::mutex> lock(mutex);
+    if (pending.size() + inFlight >= depth) {
+        const auto start = chrono::steady_clock::now();
+        notFull.wait(lock, [this] { return pending.size() + inFlight < depth; });
+        stallTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stallCount++;
+    }
+    if (failed) {
+        throw runtime_error("Failed to write to file");
+    }
+    const size_t capacity = block.size();
+    pending.push_back(std::move(block));
+    pendingSizes.push_back(size);
+    maxQueueDepth = max(maxQueueDepth, pending.size() + inFlight);
+    if (!spare.empty()) {
+        block = std::move(spare.back());
+        spare.pop_back();
+    }
+    block.resize(capacity);
+    lock.unlock();
+    notEmpty.notify_one();
+}
+
+void AsyncWriter::flush() {
+    unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return pending.empty() && inFlight == 0; });
+    if (failed) {
+        throw runtime_error("Failed to write to file");
+    }
+}
+
+size_t AsyncWriter::getQueueDepth() const {
+    lock_guard<std::mutex> lock(mutex);
+    return pending.size() + inFlight;
+}
+
+size_t AsyncWriter::getMaxQueueDepth() const {
+    lock_guard<std::mutex> lock(mutex);
+    return maxQueueDepth;
+}
+
+size_t AsyncWriter::getStallCount() const {
+    lock_guard<std::mutex> lock(mutex);
+    return stallCount;
+}
+
+double AsyncWriter::getStallTime() const {
+    lock_guard<std::mutex> lock(mutex);
+    return stallTime;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file AsyncWriter.hpp
+ * @brief AsyncWriter class
+ * @ingroup io
+ * Declares the AsyncWriter class, which writes blocks of bytes to a file from a background thread
+ */
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The AsyncWriter class writes filled blocks to a file on a background thread.
+ * @details Blocks are handed over through a bounded queue, so the producer only waits for the disk when the queue is
+ * full. Written blocks are recycled, so the producer never allocates after the queue has warmed up.
+ */
+class AsyncWriter {
+    std::FILE *file;                          ///< Output file, unbuffered so each block is a single write.
+    size_t depth;                             ///< Maximum number of blocks waiting or being written.
+    std::deque<std::vector<uint8_t>> pending; ///< Blocks waiting to be written.
+    std::deque<size_t> pendingSizes;          ///< Number of valid bytes in each pending block.
+    std::vector<std::vector<uint8_t>> spare;  ///< Written blocks ready to be reused.
+    size_t inFlight = 0;                      ///< Number of blocks being written.
+    bool stopping = false;                    ///< Whether the writer thread should exit once the queue is empty.
+    bool failed = false;                      ///< Whether a write failed.
+    size_t maxQueueDepth = 0;                 ///< Highest number of queued blocks seen.
+    size_t stallCount = 0;                    ///< Number of times the producer waited for the queue.
+    double stallTime = 0;                     ///< Total time the producer spent waiting, in seconds.
+    mutable std::mutex mutex;                 ///< Guards the queue and the counters.
+    std::condition_variable notEmpty;         ///< Signalled when a block is queued or the writer should stop.
+    std::condition_variable notFull;          ///< Signalled when a block has been written.
+    std::thread worker;                       ///< Writer thread.
+
+    /**
+     * @brief Writer thread body, writes blocks until told to stop.
+     */
+    void run();
+
+public:
+    /**
+     * @brief Constructor for the AsyncWriter class.
+     * @param filePath The path to the file, which is truncated.
+     * @param depth Number of filled blocks that may wait for the disk (2 gives triple buffering).
+     * @throws runtime_error The file can't be opened.
+     */
+    explicit AsyncWriter(const std::string &filePath, size_t depth = 2);
+
+    /**
+     * @brief Destructor for the AsyncWriter class.
+     * @details Waits for all queued blocks to be written.
+     */
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    /**
+     * @brief Queues a block to be written.
+     * @details The block is swapped with an empty one of the same size, so the caller can keep filling it.
+     * Blocks only if the queue is full.
+     * @param block The block to write.
+     * @param size Number of valid bytes in the block.
+     * @throws runtime_error A previous write failed.
+     */
+    void submit(std::vector<uint8_t> &block, size_t size);
+
+    /**
+     * @brief Waits until every queued block has been written.
+     * @throws runtime_error A write failed.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the number of blocks currently queued or being written.
+     */
+    size_t getQueueDepth() const;
+
+    /**
+     * @brief Returns the highest number of blocks that were queued or being written at once.
+     */
+    size_t getMaxQueueDepth() const;
+
+    /**
+     * @brief Returns how many times submit had to wait for the queue.
+     */
+    size_t getStallCount() const;
+
+    /**
+     * @brief Returns the total time submit spent waiting for the queue, in seconds.
+     */
+    double getStallTime() const;
+};
@@ -1,64 +1,131 @@
 #include "BitStream.hpp"
-#include <bitset>
-#include <cassert>
-#include <iostream>
+#include "AsyncWriter.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 BitStream::BitStream(const string &filePath,
                      ios_base::openmode mode) {
+    writing = (mode & ios::out) != 0;
+    if (!writing && mapFile(filePath)) {
+        return;
+    }
     file.open(filePath, mode | std::ios::binary);
     if (!file.is_open()) {
         throw runtime_error("File does not exist or can't be opened");
     }
-    currentByte = 0;
-    buffer = vector<uint8_t>(0);
-    bufferSize = 0;
+    buffer = vector<uint8_t>(BLOCK_SIZE);
+    readData = buffer.data();
 }
 
-BitStream::~BitStream() {
-    flushBuffer();// Ensure that any remaining bits are written to the file
-    file.close();
-}
+BitStream::BitStream(const string &filePath, const size_t queueDepth)
+    : writer(new AsyncWriter(filePath, queueDepth)), buffer(BLOCK_SIZE), writing(true) {}
 
-void BitStream::writeBit(int bit) {
-    currentByte <<= 1;
-    if (bit) {//!=0
-        currentByte |= 1;
+BitStream::BitStream() : buffer(MEMORY_SIZE), writing(true) {}
+
+BitStream::BitStream(const uint8_t *data, const size_t size) : readData(data), bufferEnd(size) {}
+
+BitStream::~BitStream() {
+    if (writing) {
+        // Ensure that any remaining bits are written to the file; a failed write can't be thrown from here, so callers
+        // that need to know flush first
+        try {
+            flushBuffer();
+        } catch (const exception &) {}
     }
-    bufferSize++;
-    if (bufferSize == 8) {
-        buffer.push_back(currentByte);
-        currentByte = 0;
-        bufferSize = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
     }
+#endif
+    file.close();
 }
 
-int BitStream::readBit() {
-    if (bufferSize == 0) {
-        assert(file);
-        file.read(reinterpret_cast<char *>(&currentByte), 1);
-        bufferSize = 8;
+bool BitStream::mapFile(const string &filePath) {
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    // Pipes, devices and empty files can't be mapped, those go through the fstream
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return false;
     }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);// The mapping stays valid after the descriptor is closed
+    if (addr == MAP_FAILED) return false;
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    mapping = addr;
+    mappingSize = st.st_size;
+    readData = static_cast<const uint8_t *>(addr);
+    bufferEnd = mappingSize;
+    return true;
+#else
+    return false;
+#endif
+}
 
-    const int bit = (currentByte >> (bufferSize - 1)) & 1;
-    bufferSize--;
-    return bit;
+bool BitStream::fillBuffer() {
+    if (!file.is_open()) return false;// The whole file or span is already available
+    blockStart += bufferEnd;
+    file.read(reinterpret_cast<char *>(buffer.data()), static_cast<streamsize>(buffer.size()));
+    bufferEnd = file.gcount();
+    bufferPos = 0;
+    return bufferEnd > 0;
 }
 
-void BitStream::writeBits(int value, int n) {
-    for (int i = n - 1; i >= 0; i--) {
-        writeBit(value >> i & 1);//get the nth bit and write it
+void BitStream::writeBlock() {
+    if (writer) {
+        writer->submit(buffer, bufferPos);
+        blockStart += bufferPos;
+        bufferPos = 0;
+        return;
+    }
+    if (!file.is_open()) {
+        // Grow before the buffer is completely full, so a Writer always has room for a whole word
+        if (buffer.size() - bufferPos < 8) { buffer.resize(buffer.size() * 2); }
+        return;
     }
+    file.write(reinterpret_cast<char *>(buffer.data()), static_cast<streamsize>(bufferPos));
+    blockStart += bufferPos;
+    bufferPos = 0;
 }
 
-int BitStream::readBits(int n) {
-    int result = 0;
-    for (int i = 0; i < n; i++) {
-        int bit = readBit();
-        result = (result << 1) | bit;
+void BitStream::append(const uint8_t *data, const uint64_t bitCount) {
+    size_t bytes = bitCount / 8;
+    if (accBits == 0) {
+        // Byte aligned, so whole bytes can go straight into the buffer
+        while (bytes > 0) {
+            if (bufferPos == buffer.size()) { writeBlock(); }
+            const size_t chunk = min(bytes, buffer.size() - bufferPos);
+            memcpy(&buffer[bufferPos], data, chunk);
+            bufferPos += chunk;
+            data += chunk;
+            bytes -= chunk;
+        }
+    } else {
+        for (; bytes >= 8; bytes -= 7, data += 7) {
+            writeBits(loadWord(data) >> 8, 56);
+        }
+        for (; bytes > 0; bytes--, data++) {
+            writeBits(*data, 8);
+        }
+    }
+    const int remaining = static_cast<int>(bitCount % 8);
+    if (remaining > 0) {
+        writeBits(*data >> (8 - remaining), remaining);
     }
-    return result;
+}
+
+void BitStream::append(const BitStream &other) {
+    append(other.buffer.data(), other.bufferPos * 8);
+    writeBits(other.acc, other.accBits);
 }
 
 void BitStream::writeString(const std::string &str) {
@@ -72,35 +139,71 @@ void BitStream::writeString(const std::string &str) {
 }
 
 std::string BitStream::readString() {
-    int length = readBits(32);
-    if (length == -1) {
-        return "";
-    }
+    const int length = static_cast<int>(readBits(32));
 
     std::string str;
     for (int i = 0; i < length; i++) {
-        int c = readBits(8);
-        if (c == -1) {
-            return "";
-        }
-        str.push_back(static_cast<char>(c));
+        str.push_back(static_cast<char>(readBits(8)));
     }
+    // Skip the padding added by flushBuffer
+    readBits(accBits % 8);
 
     return str;
 }
 
 void BitStream::flushBuffer() {
-    file.write(reinterpret_cast<char *>(buffer.data()), buffer.size());
-    if (currentByte) {
-        for (int i = bufferSize; i < 8; i++) {
-            currentByte <<= 1;
-        }
+    if (!writing) return;
+    if (accBits > 0) {
+        writeBits(0, 8 - accBits);
+    }
+    if (writer) {
+        writeBlock();
+        writer->flush();
+    } else if (file.is_open()) {
+        writeBlock();
+        file.flush();
+    }
+}
+
+const uint8_t *BitStream::data() const {
+    return buffer.data();
+}
+
+size_t BitStream::size() const {
+    return bufferPos;
+}
+
+const AsyncWriter *BitStream::getWriter() const {
+    return writer.get();
+}
+
+bool BitStream::isMapped() const {
+    return mapping != nullptr;
+}
+
+const uint8_t *BitStream::readWindow(size_t &size, uint64_t &bit) const {
+    if (writing || file.is_open()) { return nullptr; }
+    size = bufferEnd;
+    bit = static_cast<uint64_t>(bufferPos) * 8 - accBits;
+    return readData;
+}
+
+void BitStream::seekBit(const uint64_t bit) {
+    if (writing || file.is_open()) { throw runtime_error("Only streams read from memory can seek"); }
+    if (bit > static_cast<uint64_t>(bufferEnd) * 8) { throw runtime_error("End of stream reached"); }
+    bufferPos = bit / 8;
+    acc = 0;
+    accBits = 0;
+    // The rest of a partly read byte stays in the accumulator, its bits above accBits are never looked at
+    if (bit % 8 != 0) {
+        acc = readData[bufferPos++];
+        accBits = 8 - static_cast<int>(bit % 8);
     }
-    file.put(currentByte);
-    bufferSize = 0;
-    file.flush();
 }
 
 int BitStream::getPosition() {
-    return file.tellg();
+    if (writing) {
+        return static_cast<int>(blockStart + bufferPos);
+    }
+    return static_cast<int>(blockStart + bufferPos - accBits / 8);
 }
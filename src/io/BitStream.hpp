@@ -6,20 +6,77 @@
  */
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+class AsyncWriter;
+
 /**
  * @brief The BitStream class provides methods for reading and writing bits to a file.
+ * @details Bits go through a 64-bit accumulator and the file is accessed in blocks of BLOCK_SIZE bytes, so
+ * reading or writing up to MAX_BITS bits costs a single shift and mask.
+ * When a regular file is opened for reading only, it is memory-mapped instead and bits are read straight from the
+ * mapping.
+ * A BitStream can also live in memory, writing to a growable buffer or reading from a given span of bytes.
+ * Optionally, filled blocks can be handed to an AsyncWriter so the file is written on a background thread.
  */
 class BitStream {
-    std::fstream file;          ///< Output file stream.
-    std::vector<uint8_t> buffer;///< Buffer to store bits.
-    uint8_t currentByte;        ///< Current byte being read/written.
-    int bufferSize;             ///< Current size of the buffer.
+    std::fstream file;                   ///< Underlying file stream.
+    std::unique_ptr<AsyncWriter> writer; ///< Background writer, if writing asynchronously.
+    std::vector<uint8_t> buffer;         ///< Block of bytes read from or waiting to be written to the file.
+    const uint8_t *readData{};           ///< Bytes being read (the buffer, the mapped file or a given span).
+    void *mapping = nullptr;             ///< Memory-mapped file, if any.
+    size_t mappingSize = 0;              ///< Size of the memory-mapped file.
+    size_t bufferPos = 0;                ///< Position of the next byte to be read/written in the buffer.
+    size_t bufferEnd = 0;                ///< Number of valid bytes in the buffer (reading only).
+    uint64_t blockStart = 0;             ///< Offset in the file of the first byte of the buffer.
+    uint64_t acc = 0;                    ///< Bit accumulator, the most recent bits are the least significant ones.
+    int accBits = 0;                     ///< Number of valid bits in the accumulator.
+    bool writing = false;                ///< Whether the stream was opened for writing.
+
+    /**
+     * @brief Tries to memory-map the file for reading.
+     * @param filePath The path to the file.
+     * @return Whether the file was mapped.
+     */
+    bool mapFile(const std::string &filePath);
+
+    /**
+     * @brief Loads the next block of the file into the buffer.
+     * @return Whether any bytes were read.
+     */
+    bool fillBuffer();
+
+    /**
+     * @brief Writes the bytes currently in the buffer to the file.
+     * @details In memory, the buffer is grown instead if it is full.
+     */
+    void writeBlock();
+
+    /**
+     * @brief Tops the accumulator up to at least MAX_BITS bits, unless the end of the stream is reached.
+     */
+    void refill();
+
+    /**
+     * @brief Loads 8 bytes as a big-endian word.
+     * @param bytes Pointer to the first byte.
+     * @return The loaded word.
+     */
+    static uint64_t loadWord(const uint8_t *bytes);
 
 public:
+    static constexpr int MAX_BITS = 57;           ///< Maximum number of bits handled by a single call.
+    static constexpr size_t BLOCK_SIZE = 1 << 20;///< Size of the blocks read from/written to the file.
+    static constexpr size_t MEMORY_SIZE = 1 << 12;///< Initial size of the buffer of an in-memory BitStream.
+
+    class Writer;
+    class Reader;
+
     /**
      * @brief Constructor for the BitStream class.
      * @param filePath The path to the file.
@@ -27,14 +84,38 @@ public:
      */
     BitStream(const std::string &filePath, std::ios_base::openmode mode);
 
+    /**
+     * @brief Constructor for a BitStream that writes to a file on a background thread.
+     * @details The encoding thread only waits for the disk when queueDepth blocks are already waiting to be written.
+     * @param filePath The path to the file.
+     * @param queueDepth Number of filled blocks that may wait for the disk (2 gives triple buffering).
+     */
+    BitStream(const std::string &filePath, size_t queueDepth);
+
+    /**
+     * @brief Constructor for an in-memory BitStream that writes to a growable buffer.
+     */
+    BitStream();
+
+    /**
+     * @brief Constructor for an in-memory BitStream that reads from a span of bytes.
+     * @details The bytes are not copied, so they must outlive the BitStream.
+     * @param data Pointer to the first byte.
+     * @param size Number of bytes.
+     */
+    BitStream(const uint8_t *data, size_t size);
+
     /**
      * @brief Helper function to flush the buffer by writing its contents to the file.
+     * @details Pads the last byte with zeros, so the stream is byte aligned afterwards.
+     * @throws runtime_error A background write failed.
      */
     void flushBuffer();
 
     /**
      * @brief Destructor for the BitStream class.
-     * @details Flushes the buffer to ensure that any remaining bits are written to the file.
+     * @details Flushes the buffer to ensure that any remaining bits are written to the file. Write errors are
+     * swallowed, so callers that need to see them must call flushBuffer first.
      */
     ~BitStream();
 
@@ -55,17 +136,56 @@ public:
      * @brief Writes multiple bits to the file.
      * @details The bits are written from the MSB to the LSB.
      * @param value The value containing the bits to be written.
-     * @param n The number of bits to write.
+     * @param n The number of bits to write (at most MAX_BITS).
      */
-    void writeBits(int value, int n);
+    void writeBits(uint64_t value, int n);
 
     /**
      * @brief Reads multiple bits from the file.
-     * @param n The number of bits to read.
+     * @param n The number of bits to read (at most MAX_BITS).
+     * @throws runtime_error EOF is reached.
+     * @return The read value containing the bits.
+     */
+    uint64_t readBits(int n);
+
+    /**
+     * @brief Returns the next bits of the file without consuming them.
+     * @details Bits past the end of the file are read as zeros.
+     * @param n The number of bits to peek (at most MAX_BITS).
+     * @return The value containing the bits.
+     */
+    uint64_t peekBits(int n);
+
+    /**
+     * @brief Discards bits from the file.
+     * @param n The number of bits to skip.
      * @throws runtime_error EOF is reached.
-     * @return The read value containing the bits, or -1 if the end of the file is reached.
      */
-    int readBits(int n);
+    void skipBits(int n);
+
+    /**
+     * @brief Moves the next bit to be read to any position, without reading the bits in between.
+     * @details Only for streams whose bytes are all in memory, see readWindow.
+     * @param bit Position of the bit, counted from the MSB of the first byte.
+     * @throws runtime_error The stream isn't read from memory, or the position is past its end.
+     */
+    void seekBit(uint64_t bit);
+
+    /**
+     * @brief Appends bits from a span of bytes.
+     * @details The bits don't need to be byte aligned on either side. If the stream is byte aligned whole bytes are
+     * copied, otherwise they are shifted in 56 bits at a time.
+     * @param data Pointer to the first byte, whose MSB is the first bit to append.
+     * @param bitCount Number of bits to append.
+     */
+    void append(const uint8_t *data, uint64_t bitCount);
+
+    /**
+     * @brief Appends every bit written so far to an in-memory BitStream.
+     * @details Lets independently encoded substreams be joined into a single, bit-exact stream.
+     * @param other The in-memory BitStream to append.
+     */
+    void append(const BitStream &other);
 
     /**
      * @brief Writes a string to the file.
@@ -76,14 +196,315 @@ public:
 
     /**
      * @brief Reads a string from the file.
-     * @return The read string, or an empty string if the end of the file is reached.
+     * @return The read string.
+     * @throws runtime_error EOF is reached.
      * Reads the length of the string and then reads the binary representation of each character.
      */
     std::string readString();
 
     /**
-     * \brief Returns the current position of the file pointer
-     * \return Position of the file pointer
+     * \brief Returns the bytes written to an in-memory BitStream
+     * \details Call flushBuffer first to include the last, incomplete byte
+     * \return Pointer to the first byte
+     */
+    const uint8_t *data() const;
+
+    /**
+     * \brief Returns the number of bytes written to an in-memory BitStream
+     * \return Number of complete bytes in the buffer
+     */
+    size_t size() const;
+
+    /**
+     * \brief Returns the background writer
+     * \details Gives access to its queue depth and stall time counters
+     * \return The AsyncWriter, or nullptr if the stream is not written asynchronously
+     */
+    const AsyncWriter *getWriter() const;
+
+    /**
+     * \brief Returns every byte of a stream being read, if they are all in memory
+     * \details That is the case for memory-mapped files and in-memory streams. The bytes can be read from other threads,
+     * as long as the stream outlives them.
+     * \param size Set to the number of bytes.
+     * \param bit Set to the position of the next bit to be read, counted from the MSB of the first byte.
+     * \return Pointer to the first byte, or nullptr if the stream is written or read block by block.
+     */
+    const uint8_t *readWindow(size_t &size, uint64_t &bit) const;
+
+    /**
+     * \brief Checks whether the stream is reading from a memory-mapped file
+     * \return Whether the file is memory-mapped
+     */
+    bool isMapped() const;
+
+    /**
+     * \brief Returns the current position in the stream
+     * \return Number of whole bytes read/written so far
      */
     int getPosition();
 };
+
+/**
+ * @brief Writes a run of codes to a BitStream with the accumulator held in local variables.
+ * @details BitStream::writeBits stores bytes through a pointer that may alias the stream, so its accumulator is
+ * reloaded after every byte. A Writer keeps its own copy, which the compiler can leave in registers, and stores 32 bits
+ * at a time. The stream must not be used directly while a Writer is active, except between store and load.
+ */
+class BitStream::Writer {
+    BitStream &bs;   ///< Stream being written.
+    uint64_t acc;    ///< Bit accumulator, as in BitStream.
+    int accBits;     ///< Number of valid bits in the accumulator.
+    uint8_t *out;    ///< Buffer of the stream.
+    size_t pos;      ///< Position of the next byte in the buffer.
+    size_t end;      ///< Size of the buffer.
+
+    /**
+     * @brief Hands the whole bytes to the stream and makes room for at least 4 more bytes in the buffer.
+     */
+    void spill();
+
+public:
+    /**
+     * @brief Starts a run of codes on a stream opened for writing.
+     * @param stream The stream.
+     */
+    explicit Writer(BitStream &stream);
+
+    /**
+     * @brief Hands the bits written so far back to the stream.
+     */
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    /**
+     * @brief Writes bits, from the MSB to the LSB.
+     * @param value The bits to be written, with nothing set above the n lowest bits.
+     * @param n The number of bits to write (at most 32).
+     */
+    void put(uint64_t value, int n);
+
+    /**
+     * @brief Hands the bits written so far back to the stream, so it can be written to directly.
+     */
+    void store();
+
+    /**
+     * @brief Takes over the stream again after store.
+     */
+    void load();
+};
+
+/**
+ * @brief Reads a run of codes from a BitStream with the accumulator held in local variables.
+ * @details The counterpart of BitStream::Writer. The stream must not be used directly while a Reader is active, except
+ * between store and load.
+ */
+class BitStream::Reader {
+    BitStream &bs;      ///< Stream being read.
+    uint64_t acc;       ///< Bit accumulator, as in BitStream.
+    int accBits;        ///< Number of valid bits in the accumulator.
+    const uint8_t *in;  ///< Bytes being read.
+    size_t pos;         ///< Position of the next byte.
+    size_t end;         ///< Number of valid bytes.
+
+public:
+    /**
+     * @brief Starts a run of codes on a stream opened for reading.
+     * @param stream The stream.
+     */
+    explicit Reader(BitStream &stream);
+
+    /**
+     * @brief Hands the position reached back to the stream.
+     */
+    ~Reader();
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    /**
+     * @brief Returns the next 32 bits without consuming them.
+     * @details Bits past the end of the stream are read as zeros.
+     * @return The bits, starting at the MSB.
+     */
+    uint32_t peek();
+
+    /**
+     * @brief Discards bits, which must have been peeked.
+     * @param n The number of bits to skip (at most 32).
+     * @throws runtime_error EOF is reached.
+     */
+    void skip(int n);
+
+    /**
+     * @brief Hands the position reached back to the stream, so it can be read from directly.
+     */
+    void store();
+
+    /**
+     * @brief Takes over the stream again after store.
+     */
+    void load();
+};
+
+// The per-call paths are kept inline so that callers such as Golomb can have them inlined; only the block I/O lives in
+// BitStream.cpp
+
+inline uint64_t BitStream::loadWord(const uint8_t *bytes) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+inline void BitStream::refill() {
+    while (accBits <= 56) {
+        if (bufferPos == bufferEnd && !fillBuffer()) return;
+        if (bufferEnd - bufferPos >= 8) {
+            // Load a whole word and keep as many bytes as fit in the accumulator
+            const uint64_t word = loadWord(readData + bufferPos);
+            const int bytes = (64 - accBits) >> 3;
+            acc = bytes == 8 ? word : (acc << (bytes * 8)) | (word >> (64 - bytes * 8));
+            accBits += bytes * 8;
+            bufferPos += bytes;
+            return;
+        }
+        acc = (acc << 8) | readData[bufferPos++];
+        accBits += 8;
+    }
+}
+
+inline void BitStream::writeBits(const uint64_t value, const int n) {
+    acc = (acc << n) | (value & ((uint64_t{1} << n) - 1));
+    accBits += n;
+    while (accBits >= 8) {
+        if (bufferPos == buffer.size()) { writeBlock(); }
+        accBits -= 8;
+        buffer[bufferPos++] = static_cast<uint8_t>(acc >> accBits);
+    }
+}
+
+inline void BitStream::writeBit(const int bit) {
+    writeBits(bit != 0, 1);
+}
+
+inline uint64_t BitStream::readBits(const int n) {
+    if (n == 0) { return 0; }
+    if (accBits < n) {
+        refill();
+        if (accBits < n) { throw std::runtime_error("End of stream reached"); }
+    }
+    accBits -= n;
+    return (acc >> accBits) & ((uint64_t{1} << n) - 1);
+}
+
+inline int BitStream::readBit() {
+    return static_cast<int>(readBits(1));
+}
+
+inline uint64_t BitStream::peekBits(const int n) {
+    if (n == 0) { return 0; }
+    if (accBits < n) {
+        refill();
+        if (accBits < n) { return (acc << (n - accBits)) & ((uint64_t{1} << n) - 1); }
+    }
+    return (acc >> (accBits - n)) & ((uint64_t{1} << n) - 1);
+}
+
+inline void BitStream::skipBits(int n) {
+    while (n > MAX_BITS) {
+        readBits(MAX_BITS);
+        n -= MAX_BITS;
+    }
+    readBits(n);
+}
+
+inline BitStream::Writer::Writer(BitStream &stream) : bs(stream) { load(); }
+
+inline BitStream::Writer::~Writer() { store(); }
+
+inline void BitStream::Writer::load() {
+    acc = bs.acc;
+    accBits = bs.accBits;
+    out = bs.buffer.data();
+    pos = bs.bufferPos;
+    end = bs.buffer.size();
+}
+
+inline void BitStream::Writer::store() {
+    bs.acc = acc;
+    bs.accBits = accBits;
+    bs.bufferPos = pos;
+    bs.writeBits(0, 0);// Drains whole bytes, which BitStream expects to be gone
+}
+
+inline void BitStream::Writer::spill() {
+    store();
+    if (bs.buffer.size() - bs.bufferPos < 4) { bs.writeBlock(); }
+    load();
+}
+
+inline void BitStream::Writer::put(const uint64_t value, const int n) {
+    acc = (acc << n) | value;
+    accBits += n;
+    if (accBits >= 32) {
+        if (end - pos < 4) {
+            spill();// The stream has taken all the whole bytes already
+            return;
+        }
+        accBits -= 32;
+        auto word = static_cast<uint32_t>(acc >> accBits);
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap32(word);
+#endif
+        std::memcpy(out + pos, &word, sizeof(word));
+        pos += 4;
+    }
+}
+
+inline BitStream::Reader::Reader(BitStream &stream) : bs(stream) { load(); }
+
+inline BitStream::Reader::~Reader() { store(); }
+
+inline void BitStream::Reader::load() {
+    acc = bs.acc;
+    accBits = bs.accBits;
+    in = bs.readData;
+    pos = bs.bufferPos;
+    end = bs.bufferEnd;
+}
+
+inline void BitStream::Reader::store() {
+    bs.acc = acc;
+    bs.accBits = accBits;
+    bs.bufferPos = pos;
+}
+
+inline uint32_t BitStream::Reader::peek() {
+    if (accBits < 32) {
+        if (end - pos >= 8) {
+            const uint64_t word = loadWord(in + pos);
+            const int bytes = (64 - accBits) >> 3;
+            acc = bytes == 8 ? word : (acc << (bytes * 8)) | (word >> (64 - bytes * 8));
+            accBits += bytes * 8;
+            pos += bytes;
+        } else {
+            // Near the end of the buffer, the stream knows how to load the next block
+            store();
+            bs.refill();
+            load();
+            if (accBits < 32) { return static_cast<uint32_t>(acc << (32 - accBits)); }
+        }
+    }
+    return static_cast<uint32_t>(acc >> (accBits - 32));
+}
+
+inline void BitStream::Reader::skip(const int n) {
+    if (n > accBits) { throw std::runtime_error("End of stream reached"); }
+    accBits -= n;
+}
@@ -0,0 +1,213 @@
+#include "Cabac.hpp"
+#include "Golomb.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    constexpr uint32_t TOP = 1u << 24;              ///< The interval is widened once it gets narrower than this
+    constexpr uint16_t HALF = 1u << (Cabac::PROB_BITS - 1);///< Probability of a bin that was never seen
+    constexpr uint32_t MAX_MAGNITUDE = 1u << 16;     ///< Magnitudes above this are the same neighbourhood
+}// namespace
+
+constexpr int Cabac::PROB_BITS;
+constexpr int Cabac::ADAPT_SHIFT;
+constexpr int Cabac::NEIGHBOURHOODS;
+constexpr int Cabac::PREFIX;
+constexpr int Cabac::BUCKETS;
+
+Cabac::Cabac() { reset(); }
+
+void Cabac::reset() {
+    for (Contexts &context: contexts) {
+        context.zero = HALF;
+        context.prefix.fill(HALF);
+        context.bucket.fill(HALF);
+    }
+    last = 0;
+    before_last = 0;
+    count = 0;
+}
+
+int Cabac::neighbourhood() const {
+    const int activity = last + before_last;
+    if (activity == 0) { return 0; }
+    if (activity <= 2) { return 1; }
+    if (activity <= 6) { return 2; }
+    if (activity <= 16) { return 3; }
+    if (activity <= 40) { return 4; }
+    if (activity <= 100) { return 5; }
+    return 6;
+}
+
+void Cabac::push(const int magnitude) {
+    before_last = last;
+    last = magnitude;
+}
+
+void Cabac::shiftLow() {
+    // A byte can only be written once no carry can reach it, the 0xFF bytes after it are held back with it
+    if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+        const auto carry = static_cast<uint8_t>(low >> 32);
+        uint8_t byte = cache;
+        do {
+            bytes.push_back(static_cast<uint8_t>(byte + carry));
+            byte = 0xFF;
+        } while (--pending != 0);
+        cache = static_cast<uint8_t>(low >> 24);
+    }
+    pending++;
+    low = (low & 0x00FFFFFFu) << 8;
+}
+
+void Cabac::encodeBin(uint16_t &probability, const int bin) {
+    const uint32_t bound = (range >> PROB_BITS) * probability;
+    if (bin == 0) {
+        range = bound;
+        probability += ((1u << PROB_BITS) - probability) >> ADAPT_SHIFT;
+    } else {
+        low += bound;
+        range -= bound;
+        probability -= probability >> ADAPT_SHIFT;
+    }
+    while (range < TOP) {
+        range <<= 8;
+        shiftLow();
+    }
+}
+
+void Cabac::encodeBypass(const uint32_t bits, const int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        range >>= 1;
+        if (bits >> i & 1) { low += range; }
+        while (range < TOP) {
+            range <<= 8;
+            shiftLow();
+        }
+    }
+}
+
+void Cabac::encode(const int n) {
+    count++;
+    Contexts &context = contexts[neighbourhood()];
+    const uint32_t magnitude = n < 0 ? 0u - static_cast<uint32_t>(n) : static_cast<uint32_t>(n);
+    encodeBin(context.zero, n != 0);
+    if (n != 0) {
+        const uint32_t rest = magnitude - 1;
+        int bin = 0;
+        for (; bin < PREFIX && static_cast<uint32_t>(bin) < rest; bin++) { encodeBin(context.prefix[bin], 1); }
+        if (bin < PREFIX) {
+            encodeBin(context.prefix[bin], 0);
+        } else {
+            // Exp-Golomb suffix: the bucket, which is the bit length, in unary, then the bits below the leading one
+            const uint32_t suffix = rest - PREFIX + 1;
+            const int length = bitLength(suffix);
+            for (int i = 1; i < length; i++) { encodeBin(context.bucket[i - 1], 1); }
+            if (length < BUCKETS) { encodeBin(context.bucket[length - 1], 0); }
+            encodeBypass(suffix, length - 1);
+        }
+        encodeBypass(n < 0, 1);
+    }
+    push(static_cast<int>(min(magnitude, MAX_MAGNITUDE)));
+}
+
+template<typename T>
+void Cabac::encodeSpan(const T *values, const size_t count_) {
+    for (size_t i = 0; i < count_; i++) { encode(values[i]); }
+}
+
+void Cabac::encode_span(const int16_t *values, const size_t count_) { encodeSpan(values, count_); }
+
+void Cabac::encode_span(const int *values, const size_t count_) { encodeSpan(values, count_); }
+
+void Cabac::write(BitStream &bs) {
+    // A coder that was never used writes an empty block
+    if (count == 0) {
+        bs.writeBits(0, 32);
+        return;
+    }
+    for (int i = 0; i < 5; i++) { shiftLow(); }
+    bs.writeBits(bytes.size(), 32);
+    bs.append(bytes.data(), static_cast<uint64_t>(bytes.size()) * 8);
+    bytes.clear();
+    low = 0;
+    range = UINT32_MAX;
+    cache = 0;
+    pending = 1;
+    reset();
+}
+
+void Cabac::read(BitStream &bs) {
+    const auto size = static_cast<size_t>(bs.readBits(32));
+    // The payload is read a word at a time, and padded so that a corrupt stream can't read past it
+    bytes.assign(size + 8, 0);
+    size_t byte = 0;
+    for (; byte + 4 <= size; byte += 4) {
+        const auto word = static_cast<uint32_t>(bs.readBits(32));
+        for (int i = 0; i < 4; i++) { bytes[byte + i] = static_cast<uint8_t>(word >> (24 - 8 * i)); }
+    }
+    for (; byte < size; byte++) { bytes[byte] = static_cast<uint8_t>(bs.readBits(8)); }
+    reset();
+    range = UINT32_MAX;
+    code = 0;
+    position = 0;
+    for (int i = 0; i < 5; i++) { code = code << 8 | bytes[min(position++, bytes.size() - 1)]; }
+}
+
+int Cabac::decodeBin(uint16_t &probability) {
+    const uint32_t bound = (range >> PROB_BITS) * probability;
+    int bin;
+    if (code < bound) {
+        range = bound;
+        probability += ((1u << PROB_BITS) - probability) >> ADAPT_SHIFT;
+        bin = 0;
+    } else {
+        code -= bound;
+        range -= bound;
+        probability -= probability >> ADAPT_SHIFT;
+        bin = 1;
+    }
+    while (range < TOP) {
+        range <<= 8;
+        code = code << 8 | bytes[min(position++, bytes.size() - 1)];
+    }
+    return bin;
+}
+
+uint32_t Cabac::decodeBypass(const int n) {
+    uint32_t bits = 0;
+    for (int i = 0; i < n; i++) {
+        range >>= 1;
+        const int bit = code >= range;
+        if (bit) { code -= range; }
+        bits = bits << 1 | bit;
+        while (range < TOP) {
+            range <<= 8;
+            code = code << 8 | bytes[min(position++, bytes.size() - 1)];
+        }
+    }
+    return bits;
+}
+
+int Cabac::decode() {
+    Contexts &context = contexts[neighbourhood()];
+    uint32_t magnitude = 0;
+    if (decodeBin(context.zero)) {
+        int bin = 0;
+        while (bin < PREFIX && decodeBin(context.prefix[bin])) { bin++; }
+        uint32_t rest = bin;
+        if (bin == PREFIX) {
+            int length = 1;
+            while (length < BUCKETS && decodeBin(context.bucket[length - 1])) { length++; }
+            rest = (1u << (length - 1) | decodeBypass(length - 1)) + PREFIX - 1;
+        }
+        magnitude = rest + 1;
+    }
+    push(static_cast<int>(min(magnitude, MAX_MAGNITUDE)));
+    const bool negative = magnitude != 0 && decodeBypass(1);
+    return static_cast<int>(negative ? 0u - magnitude : magnitude);
+}
+
+void Cabac::decode_span(int *values, const size_t count_) {
+    for (size_t i = 0; i < count_; i++) { values[i] = decode(); }
+}
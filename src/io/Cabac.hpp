@@ -0,0 +1,123 @@
+/** @file Cabac.hpp
+ * @brief Header file for Cabac class
+ * @ingroup io
+ * Declares the Cabac class, a context-adaptive binary arithmetic coder for blocks of ints
+*/
+
+#pragma once
+
+#include "BitStream.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The Cabac class codes ints with a context-adaptive binary arithmetic coder
+ * @details Every int is binarised as in CABAC: a flag telling whether it is zero, a truncated unary prefix of its
+ * magnitude minus one, an Exp-Golomb suffix for the magnitudes past the prefix and its sign. The flag, the prefix and
+ * the unary bucket of the suffix are coded with adaptive probabilities, picked by the magnitudes of the two ints coded
+ * before it, so each coder should only be given one kind of value. The bits within the bucket and the sign are coded
+ * with fixed, even probabilities.
+ * encode codes the ints as they come into a private buffer, which write appends to a BitStream as one block. read
+ * loads a block, whose ints are then decoded in order by decode. The probabilities are reset for every block.
+ */
+class Cabac {
+public:
+    static constexpr int PROB_BITS = 11;     ///< Probabilities are held in PROB_BITS bits
+    static constexpr int ADAPT_SHIFT = 5;    ///< Probabilities move by 1/2^ADAPT_SHIFT of the distance to the bin
+    static constexpr int NEIGHBOURHOODS = 7; ///< Number of classes of neighbouring magnitudes
+    static constexpr int PREFIX = 4;         ///< Number of bins of the unary prefix
+    static constexpr int BUCKETS = 32;       ///< Number of Exp-Golomb buckets of the suffix, one per bit length
+
+    //! Constructor for the Cabac class, every probability starts even
+    Cabac();
+
+    //! Encodes an int into the buffer
+    //! @param n the int
+    void encode(int n);
+
+    //! Encodes a run of ints into the buffer
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int16_t *values, size_t count);
+
+    //! Encodes a run of ints into the buffer
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int *values, size_t count);
+
+    //! Writes the ints encoded so far as one block and starts a new one
+    //! @param bs BitStream to write to
+    void write(BitStream &bs);
+
+    //! Loads a block written by write
+    //! @param bs BitStream to read from
+    void read(BitStream &bs);
+
+    //! Decodes the next int of the block that was read
+    //! @return the decoded int
+    int decode();
+
+    //! Decodes the next ints of the block that was read
+    //! @param values pointer to the first int to decode into
+    //! @param count number of ints
+    void decode_span(int *values, size_t count);
+
+private:
+    //! Adaptive probabilities of a class of neighbouring magnitudes
+    struct Contexts {
+        uint16_t zero;                       ///< probability that the int is zero
+        std::array<uint16_t, PREFIX> prefix; ///< probability that each prefix bin ends the prefix
+        std::array<uint16_t, BUCKETS> bucket;///< probability that each bin of the suffix's bucket ends it
+    };
+
+    std::array<Contexts, NEIGHBOURHOODS> contexts;///< contexts of every neighbourhood
+    int last = 0;                                 ///< magnitude of the last int
+    int before_last = 0;                          ///< magnitude of the int before the last one
+    size_t count = 0;                             ///< number of ints coded in this block
+
+    std::vector<uint8_t> bytes;///< coded bytes when encoding, the block's payload when decoding
+    uint64_t low = 0;          ///< lower end of the interval, with the carry in bit 32
+    uint32_t range = UINT32_MAX;///< width of the interval
+    uint8_t cache = 0;         ///< last byte that may still take a carry
+    uint64_t pending = 1;      ///< cache plus the 0xFF bytes after it, which a carry would all change
+    uint32_t code = 0;         ///< offset of the decoded value in the interval
+    size_t position = 0;       ///< index of the next byte of the payload
+
+    //! Sets every probability back to even and forgets the neighbours and the count
+    void reset();
+
+    //! Class of the magnitudes of the last two ints
+    //! @return index in contexts
+    int neighbourhood() const;
+
+    //! Remembers the magnitude of a coded int
+    //! @param magnitude the magnitude
+    void push(int magnitude);
+
+    //! Encodes a bin with an adaptive probability
+    //! @param probability probability of a 0, adapted to the bin
+    //! @param bin the bin
+    void encodeBin(uint16_t &probability, int bin);
+
+    //! Encodes bins with even probabilities
+    //! @param bits the bins, the last at the LSB
+    //! @param n number of bins
+    void encodeBypass(uint32_t bits, int n);
+
+    //! Moves the top byte of low to the buffer, resolving carries
+    void shiftLow();
+
+    //! Decodes a bin with an adaptive probability
+    //! @param probability probability of a 0, adapted to the bin
+    //! @return the bin
+    int decodeBin(uint16_t &probability);
+
+    //! Decodes bins coded with even probabilities
+    //! @param n number of bins
+    //! @return the bins, the last at the LSB
+    uint32_t decodeBypass(int n);
+
+    template<typename T>
+    void encodeSpan(const T *values, size_t count);
+};
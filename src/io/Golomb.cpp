@@ -1,4 +1,5 @@
 #include "Golomb.hpp"
+#include <algorithm>
 #include <cmath>
 #include <string>
 
@@ -24,26 +25,105 @@ void Golomb::set_m(const int m_) {
     m = m_;
     // REPORT: We used to be calculating k and u for every encode/decode call
     k = floor(log2(m));
-    u = static_cast<int>(pow(k + 1, 2)) - m;
+    u = (1 << (k + 1)) - m;
+    table.resize(1 << TABLE_BITS);
+    for (uint32_t index = 0; index < table.size(); index++) {
+        int value = 0;
+        const int length = resolve(index << (32 - TABLE_BITS), TABLE_BITS, value);
+        table[index] = {static_cast<int16_t>(value), static_cast<uint8_t>(length)};
+    }
+    buildCodes();
 }
 int Golomb::get_m() const { return m; }
 BitStream *Golomb::get_bs() const { return bs; }
 
+void Golomb::set_encode_range(const int range) {
+    encodeRange = max(range, 0);
+    if (m > 0) { buildCodes(); }
+}
+int Golomb::get_encode_range() const { return encodeRange; }
+
+void Golomb::set_limit(const int limit_) {
+    limit = max(limit_, 0);
+    escapeAt = limit > 0 ? limit : INT_MAX;
+    // The tables depend on the limit
+    if (m > 0) { set_m(m); }
+}
+int Golomb::get_limit() const { return limit; }
+
+void Golomb::buildCodes() {
+    codes.clear();
+    if (encodeRange == 0) { return; }
+    codes.resize(2 * encodeRange + 1);
+    for (int n = -encodeRange; n <= encodeRange; n++) {
+        uint64_t code;
+        const int length = computeCodeword(n, code);
+        if (length <= 32) {
+            codes[n + encodeRange] = {static_cast<uint32_t>(code), static_cast<uint8_t>(length)};
+        } else {
+            codes[n + encodeRange] = {0, 0};
+        }
+    }
+}
+
+
+int Golomb::resolve(const uint32_t window, const int bits, int &value) const {
+    // Sign bit, then the unary quotient, whose ones are the leading zeros of the inverted window
+    // (the bit shifted in at the bottom stops the count)
+    const int q = countLeadingZeros(~(window << 1));
+    if (q >= escapeAt) { return resolveEscape(window, bits, limit, value); }
+    const int pos = q + 2;
+    if (pos + k + 1 > bits) { return 0; }
+    const int k_bits = static_cast<int>((window >> (32 - pos - k)) & ((1u << k) - 1));
+    int r = k_bits;
+    int length = pos + k;
+    if (k_bits >= u) {
+        r = (k_bits << 1) + static_cast<int>((window >> (31 - pos - k)) & 1) - u;
+        length++;
+    }
+    value = (window >> 31) != 0 ? -(q * m + r) : q * m + r;
+    return length;
+}
 
 int Golomb::decode() {
     if (m <= 0) {
-        m = bs->readBits(8 * sizeof(int));
-        k = floor(log2(m));
-        u = static_cast<int>(pow(k + 1, 2)) - m;
+        set_m(static_cast<int>(bs->readBits(8 * sizeof(int))));
+    }
+    // Most codes are resolved by a single lookup
+    const DecodeEntry &entry = table[bs->peekBits(TABLE_BITS)];
+    if (entry.length > 0) {
+        bs->skipBits(entry.length);
+        return entry.value;
     }
+    int value;
+    const auto window = static_cast<uint32_t>(bs->peekBits(32));
+    const int length = resolve(window, 32, value);
+    if (length > 0) {
+        bs->skipBits(length);
+        return value;
+    }
+    if (countLeadingZeros(~(window << 1)) >= escapeAt) {
+        // An escape that doesn't fit in the window, its ones are skipped at once
+        bs->skipBits(1 + limit);
+        const int magnitude = readEscape(bs);
+        return (window >> 31) != 0 ? -magnitude : magnitude;
+    }
+    // The code is longer than the window, so it is read bit by bit
     const int sign = (bs->readBit() == 0) ? 1 : -1;
     const int q = readUnary();
+    if (q >= escapeAt) { return sign * readEscape(bs); }
     const int r = readBinaryTrunc();
     return sign * (q * m + r);
 }
 
 void Golomb::encode(int n) const {
     assert(m > 0);
+    // Small ints, the vast majority of residuals, are a single lookup and write
+    const auto index = static_cast<uint32_t>(n + encodeRange);
+    if (index < codes.size() && codes[index].length > 0) {
+        bs->writeBits(codes[index].bits, codes[index].length);
+        return;
+    }
     if (n < 0) {
         bs->writeBit(1);
     } else {
@@ -52,15 +132,101 @@ void Golomb::encode(int n) const {
     n = abs(n);
     const int r = n % m;
     const int q = n / m;
+    if (q >= escapeAt) {
+        writeEscape(bs, n, limit);
+        return;
+    }
     writeUnary(q);
     writeBinaryTrunc(r);
 }
 
+int Golomb::codeword(const int n, uint64_t &code) const {
+    const auto index = static_cast<uint32_t>(n + encodeRange);
+    if (index < codes.size() && codes[index].length > 0) {
+        code = codes[index].bits;
+        return codes[index].length;
+    }
+    return computeCodeword(n, code);
+}
+
+int Golomb::computeCodeword(const int n, uint64_t &code) const {
+    const uint32_t sign = n < 0;
+    const uint32_t value = n < 0 ? -static_cast<uint32_t>(n) : n;
+    const uint32_t q = value / m;
+    if (q >= static_cast<uint32_t>(escapeAt)) { return escapeCodeword(sign, value, limit, code); }
+    const uint32_t r = value - q * m;
+    // Remainders from u up take one more bit and are offset by u
+    const uint32_t extra = r >= static_cast<uint32_t>(u);
+    const int r_bits = k + static_cast<int>(extra);
+    const int length = static_cast<int>(q) + r_bits + 2;
+    const uint32_t ones = q < 32 ? q : 0;// Keeps the shifts defined, the code is unused then
+    code = static_cast<uint64_t>(sign) << (ones + r_bits + 1) | ((uint64_t{1} << ones) - 1) << (r_bits + 1) |
+           (r + (u & -extra));
+    return length;
+}
+
+template<typename T>
+void Golomb::encodeSpan(const T *values, const size_t count) const {
+    assert(m > 0);
+    BitStream::Writer writer(*bs);
+    auto put = [this, &writer](const int n, const uint64_t code, const int length) {
+        if (length <= 32) {
+            writer.put(code, length);
+        } else {
+            writer.store();
+            encode(n);
+            writer.load();
+        }
+    };
+    size_t i = 0;
+    for (; i + 1 < count; i += 2) {
+        uint64_t first, second;
+        const int first_length = codeword(values[i], first);
+        const int second_length = codeword(values[i + 1], second);
+        if (first_length + second_length <= 32) {
+            writer.put(first << second_length | second, first_length + second_length);
+        } else {
+            put(values[i], first, first_length);
+            put(values[i + 1], second, second_length);
+        }
+    }
+    if (i < count) {
+        uint64_t code;
+        const int length = codeword(values[i], code);
+        put(values[i], code, length);
+    }
+}
+
+void Golomb::encode_span(const int16_t *values, const size_t count) const { encodeSpan(values, count); }
+
+void Golomb::encode_span(const int *values, const size_t count) const { encodeSpan(values, count); }
+
+void Golomb::decode_span(int *values, const size_t count) {
+    BitStream::Reader reader(*bs);
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t window = reader.peek();
+        const DecodeEntry &entry = table[window >> (32 - TABLE_BITS)];
+        if (entry.length > 0) {
+            reader.skip(entry.length);
+            values[i] = entry.value;
+            continue;
+        }
+        const int length = resolve(window, 32, values[i]);
+        if (length > 0) {
+            reader.skip(length);
+            continue;
+        }
+        reader.store();
+        values[i] = decode();
+        reader.load();
+    }
+}
+
 void Golomb::encode(const int n, const int m_) {
     k = floor(log2(m_));
-    u = static_cast<int>(pow(k + 1, 2)) - m_;
+    u = (1 << (k + 1)) - m_;
     if (m <= 0) {
-        m = m_;
+        set_m(m_);
         bs->writeBits(m_, 8 * sizeof(int));
     }
     encode(n);
@@ -71,6 +237,7 @@ int Golomb::readUnary() const {
     int q = 0;
     int bit_ = -1;
     while (bit_ != 0) {
+        if (q == escapeAt) { return q; }
         bit_ = bs->readBit();
         q++;
     }
@@ -7,21 +7,75 @@
 #pragma once
 
 #include "BitStream.hpp"
+#include <climits>
 #include <opencv2/core/mat.hpp>
 #include <string>
+#include <vector>
 
 /**
  * @brief The Golomb class provides methods to encode/decode int values using Golomb
+ * @details Short codes are decoded with a single lookup in a table built for the current m, longer ones by counting
+ * the leading ones of a 32-bit window. Only codes that don't fit in the window are read bit by bit.
+ * Codes can be length-limited: once the quotient reaches the limit, the limit ones are followed by an escape holding the
+ * value in plain binary (see writeEscape), which bounds the cost of large values.
  */
 class Golomb {
-    BitStream *bs;           ///< BitStream object
-    int m = -1;              ///< m parameter of golomb code
-    int k = -1;              ///< k parameter of golomb code
-    int u = -1;              ///< u parameter of golomb code
-    std::string filepath;    ///< path to file
-    bool localStream = false;///< whether the BitStream object was created locally
+    //! Decoded value and length of the code starting with a given TABLE_BITS bits
+    struct DecodeEntry {
+        int16_t value;    ///< decoded int
+        uint8_t length;   ///< length of the code in bits, 0 if it is longer than TABLE_BITS
+    };
+
+    //! Code of a small int, ending at the LSB
+    struct EncodeEntry {
+        uint32_t bits;    ///< the code
+        uint8_t length;   ///< length of the code in bits, 0 if it is longer than 32
+    };
+
+    BitStream *bs;                 ///< BitStream object
+    int m = -1;                    ///< m parameter of golomb code
+    int k = -1;                    ///< k parameter of golomb code
+    int u = -1;                    ///< u parameter of golomb code
+    std::vector<DecodeEntry> table;///< decode table for the current m
+    std::vector<EncodeEntry> codes;///< codes of the ints in [-encodeRange, encodeRange] for the current m
+    int encodeRange = DEFAULT_ENCODE_RANGE;///< largest absolute value held in the codes table
+    int limit = 0;                 ///< quotient from which values are escaped, 0 if codes aren't limited
+    int escapeAt = INT_MAX;        ///< limit, or INT_MAX if codes aren't limited
+    std::string filepath;          ///< path to file
+    bool localStream = false;      ///< whether the BitStream object was created locally
+
+    //! Decodes the code at the start of a window of bits
+    //! @param window the bits, starting at the MSB
+    //! @param bits number of valid bits in the window
+    //! @param value the decoded int
+    //! @return the length of the code, or 0 if it doesn't fit in the window
+    int resolve(uint32_t window, int bits, int &value) const;
+
+    //! Fills the codes table for the current m and encodeRange
+    void buildCodes();
+
+    //! Builds the code of an int, from the codes table if it is small
+    //! @param n the int to encode
+    //! @param code the code, ending at the LSB (only valid if it fits in 32 bits)
+    //! @return the length of the code in bits
+    int codeword(int n, uint64_t &code) const;
+
+    //! Computes the code of an int, without the codes table
+    //! @param n the int to encode
+    //! @param code the code, ending at the LSB (only valid if it fits in 32 bits)
+    //! @return the length of the code in bits
+    int computeCodeword(int n, uint64_t &code) const;
+
+    //! Encodes and writes a run of ints
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    template<typename T>
+    void encodeSpan(const T *values, size_t count) const;
 
 public:
+    static constexpr int TABLE_BITS = 10;///< Number of bits used to index the decode table
+    static constexpr int DEFAULT_ENCODE_RANGE = 64;///< Default range of the encode table, covers most residuals
+    static constexpr int DEFAULT_LIMIT = 24;///< Default quotient limit used by the encoders
     /**
      * \brief Constructor for the Golomb class
      * \param filePath path to file
@@ -54,6 +108,28 @@ public:
      * \return BitStream object
      */
     BitStream *get_bs() const;
+    /**
+     * \brief Sets the range of ints whose codes are precomputed
+     * \details Ints in [-range, range] are written with a single lookup, the others are computed. 0 disables the table
+     * \param range the largest absolute value held in the table
+     */
+    void set_encode_range(int range);
+    /**
+     * \brief Gets the range of ints whose codes are precomputed
+     * \return the largest absolute value held in the table
+     */
+    int get_encode_range() const;
+    /**
+     * \brief Sets the quotient from which values are escaped
+     * \details Must match between encoder and decoder, so it is signalled in the stream header
+     * \param limit_ the quotient limit, 0 for unlimited codes
+     */
+    void set_limit(int limit_);
+    /**
+     * \brief Gets the quotient from which values are escaped
+     * \return the quotient limit, 0 for unlimited codes
+     */
+    int get_limit() const;
     //! Reads and decodes a single int from file
     //! @return the decoded int
     int decode();
@@ -67,7 +143,25 @@ public:
     //! @param m_ the m parameter of golomb code (only indicated once)
     void encode(int n, int m_);
 
+    //! Encodes and writes a run of ints
+    //! @details Keeps the bit accumulator in registers for the whole run and writes pairs of short codes at once
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int16_t *values, size_t count) const;
+
+    //! Encodes and writes a run of ints
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int *values, size_t count) const;
+
+    //! Reads and decodes a run of ints
+    //! @details Keeps the bit accumulator in registers for the whole run
+    //! @param values where to store the decoded ints
+    //! @param count number of ints to decode
+    void decode_span(int *values, size_t count);
+
     //! Reads and decodes a single int from file using unary encoding
+    //! @details Stops after limit ones when codes are length-limited, without reading a terminating zero
     //! @return the decoded int
     int readUnary() const;
 
@@ -89,3 +183,80 @@ public:
     //! @return the optimal m parameter
     static int adjust_m(const std::vector<int> &data);
 };
+
+//! Counts the leading zero bits of a word
+//! @param x the word, must not be 0
+//! @return number of zero bits above the most significant one
+inline int countLeadingZeros(const uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_clz(x);
+#else
+    int n = 0;
+    for (uint32_t bit = 0x80000000u; (x & bit) == 0; bit >>= 1) { n++; }
+    return n;
+#endif
+}
+
+//! Number of bits holding the length of an escaped value
+constexpr int ESCAPE_LENGTH_BITS = 5;
+
+//! Bit length of a value
+//! @param value the value, must not be 0
+//! @return position of the most significant one, plus one
+inline int bitLength(const uint32_t value) { return 32 - countLeadingZeros(value); }
+
+//! Builds the escape code of a length-limited code
+//! @details The sign, limit ones, the bit length L of the value in ESCAPE_LENGTH_BITS bits, then the value in L bits
+//! @param sign 1 if the value is negative
+//! @param value absolute value, must not be 0
+//! @param limit the quotient limit
+//! @param code the code, ending at the LSB (only valid if it fits in 32 bits)
+//! @return the length of the code in bits
+inline int escapeCodeword(const uint32_t sign, const uint32_t value, const int limit, uint64_t &code) {
+    const int bits = bitLength(value);
+    const int length = 1 + limit + ESCAPE_LENGTH_BITS + bits;
+    if (length <= 32) {
+        code = static_cast<uint64_t>(sign) << (length - 1) |
+               ((uint64_t{1} << limit) - 1) << (ESCAPE_LENGTH_BITS + bits) |
+               static_cast<uint64_t>(bits) << bits | value;
+    }
+    return length;
+}
+
+//! Decodes the escape code at the start of a window of bits
+//! @param window the bits, starting at the MSB
+//! @param bits number of valid bits in the window
+//! @param limit the quotient limit, the window must start with the sign and limit ones
+//! @param value the decoded int
+//! @return the length of the code, or 0 if it doesn't fit in the window
+inline int resolveEscape(const uint32_t window, const int bits, const int limit, int &value) {
+    const int prefix = 1 + limit + ESCAPE_LENGTH_BITS;
+    if (prefix > bits) { return 0; }
+    const int value_bits = static_cast<int>(window >> (32 - prefix)) & ((1 << ESCAPE_LENGTH_BITS) - 1);
+    const int length = prefix + value_bits;
+    if (length > bits) { return 0; }
+    const auto magnitude = static_cast<int>(window >> (32 - length) & ((1u << value_bits) - 1));
+    value = (window >> 31) != 0 ? -magnitude : magnitude;
+    return length;
+}
+
+//! Writes the ones and the escape of a length-limited code, after its sign
+//! @param bs BitStream to write to
+//! @param value absolute value, must not be 0
+//! @param limit the quotient limit
+inline void writeEscape(BitStream *bs, const uint32_t value, const int limit) {
+    int ones = limit;
+    for (; ones >= 32; ones -= 32) { bs->writeBits(0xFFFFFFFF, 32); }
+    bs->writeBits((uint64_t{1} << ones) - 1, ones);
+    const int bits = bitLength(value);
+    bs->writeBits(bits, ESCAPE_LENGTH_BITS);
+    bs->writeBits(value, bits);
+}
+
+//! Reads the escape of a length-limited code, after its sign and ones
+//! @param bs BitStream to read from
+//! @return the absolute value
+inline int readEscape(BitStream *bs) {
+    const int bits = static_cast<int>(bs->readBits(ESCAPE_LENGTH_BITS));
+    return static_cast<int>(bs->readBits(bits));
+}
@@ -0,0 +1,45 @@
+#include "GolombEstimator.hpp"
+#include <cstdlib>
+
+void GolombEstimator::add(const int value) {
+    const auto magnitude = static_cast<uint32_t>(std::abs(value));
+    for (int k = 0; k <= MAX_K; k++) { quotients[k] += magnitude >> k; }
+    samples++;
+}
+
+template<typename T>
+void GolombEstimator::addSpan(const T *values, const size_t count) {
+    // One pass per k keeps the inner loop free of dependencies, so it vectorizes
+    for (int k = 0; k <= MAX_K; k++) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; i++) { sum += static_cast<uint32_t>(std::abs(values[i])) >> k; }
+        quotients[k] += sum;
+    }
+    samples += count;
+}
+
+void GolombEstimator::add_span(const int *values, const size_t count) { addSpan(values, count); }
+
+void GolombEstimator::add_span(const int16_t *values, const size_t count) { addSpan(values, count); }
+
+void GolombEstimator::merge(const GolombEstimator &other) {
+    for (int k = 0; k <= MAX_K; k++) { quotients[k] += other.quotients[k]; }
+    samples += other.samples;
+}
+
+uint64_t GolombEstimator::count() const { return samples; }
+
+uint64_t GolombEstimator::bits(const int k) const {
+    // Every code has a sign bit, the unary quotient and its stop bit, and k remainder bits
+    return quotients[k] + samples * (k + 2);
+}
+
+int GolombEstimator::best_k() const {
+    int best = 0;
+    for (int k = 1; k <= MAX_K; k++) {
+        if (bits(k) < bits(best)) { best = k; }
+    }
+    return best;
+}
+
+int GolombEstimator::best_m() const { return 1 << best_k(); }
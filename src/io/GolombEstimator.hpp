@@ -0,0 +1,67 @@
+/** @file GolombEstimator.hpp
+ * @brief Header file for GolombEstimator class
+ * @ingroup io
+ * Declares the GolombEstimator class, which picks the Golomb m parameter from a stream of values
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The GolombEstimator class finds the best power-of-two Golomb m parameter for a set of values
+ * @details Values are added as they are produced, so they never need to be collected. For every candidate k the
+ * estimator sums the quotients |x| >> k, which gives the exact code length with m = 2^k. Estimators that saw
+ * different values can be merged, so each thread can fill its own and combine them at the end.
+ */
+class GolombEstimator {
+public:
+    static constexpr int MAX_K = 7;///< Largest k considered, so that m fits in the 8-bit header field
+
+    //! Adds a value
+    //! @param value the value
+    void add(int value);
+
+    //! Adds a run of values
+    //! @param values pointer to the first value
+    //! @param count number of values
+    void add_span(const int *values, size_t count);
+
+    //! Adds a run of values
+    //! @param values pointer to the first value
+    //! @param count number of values
+    void add_span(const int16_t *values, size_t count);
+
+    //! Adds the values seen by another estimator
+    //! @param other the other estimator
+    void merge(const GolombEstimator &other);
+
+    //! Gets the number of values added
+    //! @return the number of values
+    uint64_t count() const;
+
+    //! Gets the size in bits of the values coded with m = 2^k
+    //! @param k log2(m)
+    //! @return the size in bits, ignoring escapes
+    uint64_t bits(int k) const;
+
+    //! Finds the k that codes the values in the fewest bits
+    //! @return the best k, 0 if no values were added
+    int best_k() const;
+
+    //! Finds the m that codes the values in the fewest bits
+    //! @return 2^best_k()
+    int best_m() const;
+
+private:
+    uint64_t samples = 0;                       ///< number of values
+    std::array<uint64_t, MAX_K + 1> quotients{};///< sum of |x| >> k, for every k
+
+    //! Adds a run of values
+    //! @param values pointer to the first value
+    //! @param count number of values
+    template<typename T>
+    void addSpan(const T *values, size_t count);
+};
@@ -0,0 +1,203 @@
+#include "Rans.hpp"
+#include "Golomb.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    //! Maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+    uint32_t zigzag(const int n) { return (static_cast<uint32_t>(n) << 1) ^ static_cast<uint32_t>(n >> 31); }
+
+    //! Inverse of zigzag
+    int unzigzag(const uint32_t n) { return static_cast<int>(n >> 1) ^ -static_cast<int>(n & 1); }
+
+    constexpr int LENGTH_BITS = 6;       ///< Bits holding the bit length of an escaped value
+    constexpr int CHUNK_BITS = 16;       ///< Bits of an escaped value coded by a single step
+    constexpr int TABLE_LENGTH_BITS = 4; ///< Bits holding the bit length of a frequency
+}// namespace
+
+constexpr int Rans::STATES;
+constexpr int Rans::PROB_BITS;
+constexpr int Rans::SYMBOLS;
+constexpr int Rans::ESCAPE;
+constexpr uint32_t Rans::LOWER;
+
+void Rans::encode(const int n) { values.push_back(n); }
+
+template<typename T>
+void Rans::encodeSpan(const T *values_, const size_t count) { values.insert(values.end(), values_, values_ + count); }
+
+void Rans::encode_span(const int16_t *values_, const size_t count) { encodeSpan(values_, count); }
+
+void Rans::encode_span(const int *values_, const size_t count) { encodeSpan(values_, count); }
+
+void Rans::normalize(const vector<uint32_t> &counts, vector<uint32_t> &freqs) {
+    constexpr uint32_t total = 1u << PROB_BITS;
+    uint64_t count = 0;
+    for (const uint32_t c: counts) { count += c; }
+    freqs.assign(SYMBOLS, 0);
+    if (count == 0) { return; }
+    int64_t sum = 0;
+    for (int s = 0; s < SYMBOLS; s++) {
+        if (counts[s] == 0) { continue; }
+        freqs[s] = max<uint32_t>(1, static_cast<uint32_t>(uint64_t{counts[s]} * total / count));
+        sum += freqs[s];
+    }
+    // Rounding and the symbols kept at 1 are made up for by the most frequent symbols
+    while (sum != total) {
+        const int largest = static_cast<int>(max_element(freqs.begin(), freqs.end()) - freqs.begin());
+        if (sum < total) {
+            freqs[largest] += static_cast<uint32_t>(total - sum);
+            sum = total;
+        } else {
+            const auto take = static_cast<uint32_t>(min<int64_t>(sum - total, freqs[largest] - 1));
+            const auto share = max<uint32_t>(1, min(take, freqs[largest] / 2));
+            freqs[largest] -= share;
+            sum -= share;
+        }
+    }
+}
+
+void Rans::writeTable(BitStream &bs, const vector<uint32_t> &freqs) {
+    int used = SYMBOLS;
+    while (used > 0 && freqs[used - 1] == 0) { used--; }
+    bs.writeBits(used, 9);
+    for (int s = 0; s < used; s++) {
+        // The bit length, then the bits below the leading one
+        const int length = freqs[s] == 0 ? 0 : bitLength(freqs[s]);
+        bs.writeBits(length, TABLE_LENGTH_BITS);
+        if (length > 1) { bs.writeBits(freqs[s], length - 1); }
+    }
+}
+
+void Rans::readTable(BitStream &bs, vector<uint32_t> &freqs) {
+    freqs.assign(SYMBOLS, 0);
+    const int used = static_cast<int>(bs.readBits(9));
+    for (int s = 0; s < used; s++) {
+        const int length = static_cast<int>(bs.readBits(TABLE_LENGTH_BITS));
+        if (length == 0) { continue; }
+        freqs[s] = 1u << (length - 1);
+        if (length > 1) { freqs[s] |= static_cast<uint32_t>(bs.readBits(length - 1)); }
+    }
+}
+
+void Rans::write(BitStream &bs) {
+    bs.writeBits(values.size(), 32);
+    if (values.empty()) { return; }
+    vector<uint32_t> counts(SYMBOLS, 0);
+    for (const int n: values) { counts[min<uint32_t>(zigzag(n), ESCAPE)]++; }
+    vector<uint32_t> freqs;
+    normalize(counts, freqs);
+    vector<uint32_t> cumulative(SYMBOLS + 1, 0);
+    for (int s = 0; s < SYMBOLS; s++) { cumulative[s + 1] = cumulative[s] + freqs[s]; }
+    // The steps are listed in decoding order, since rANS codes them backwards
+    vector<Operation> operations;
+    operations.reserve(values.size());
+    for (const int n: values) {
+        const uint32_t symbol = zigzag(n);
+        if (symbol < ESCAPE) {
+            operations.push_back({static_cast<uint16_t>(cumulative[symbol]), static_cast<uint16_t>(freqs[symbol]), PROB_BITS});
+            continue;
+        }
+        operations.push_back({static_cast<uint16_t>(cumulative[ESCAPE]), static_cast<uint16_t>(freqs[ESCAPE]), PROB_BITS});
+        const uint32_t extra = symbol - ESCAPE;
+        const int length = extra == 0 ? 0 : bitLength(extra);
+        operations.push_back({static_cast<uint16_t>(length), 1, LENGTH_BITS});
+        for (int shift = (length - 1) / CHUNK_BITS * CHUNK_BITS; length > 0 && shift >= 0; shift -= CHUNK_BITS) {
+            const int bits = min(CHUNK_BITS, length - shift);
+            operations.push_back({static_cast<uint16_t>(extra >> shift & ((1u << bits) - 1)), 1, static_cast<uint8_t>(bits)});
+        }
+    }
+    // Each step emits at most 2 bytes, and each state 4 more when flushed
+    vector<uint8_t> payload(2 * operations.size() + 4 * STATES);
+    uint8_t *end = payload.data() + payload.size();
+    uint8_t *ptr = end;
+    uint32_t states[STATES];
+    fill(states, states + STATES, LOWER);
+    for (size_t i = operations.size(); i-- > 0;) {
+        const Operation &operation = operations[i];
+        uint32_t &x = states[i % STATES];
+        const uint32_t limit = ((LOWER >> operation.bits) << 8) * operation.freq;
+        while (x >= limit) {
+            *--ptr = static_cast<uint8_t>(x);
+            x >>= 8;
+        }
+        x = ((x / operation.freq) << operation.bits) + x % operation.freq + operation.start;
+    }
+    for (int s = STATES - 1; s >= 0; s--) {
+        ptr -= 4;
+        for (int byte = 0; byte < 4; byte++) { ptr[byte] = static_cast<uint8_t>(states[s] >> (8 * byte)); }
+    }
+    const auto size = static_cast<size_t>(end - ptr);
+    writeTable(bs, freqs);
+    bs.writeBits(size, 32);
+    bs.append(ptr, static_cast<uint64_t>(size) * 8);
+    values.clear();
+}
+
+void Rans::read(BitStream &bs) {
+    const auto count = static_cast<size_t>(bs.readBits(32));
+    values.resize(count);
+    position = 0;
+    if (count == 0) { return; }
+    vector<uint32_t> freqs;
+    readTable(bs, freqs);
+    const auto size = static_cast<size_t>(bs.readBits(32));
+    // The payload is read a word at a time, and padded so that a corrupt stream can't read past it
+    vector<uint8_t> payload(size + 8, 0);
+    size_t byte = 0;
+    for (; byte + 4 <= size; byte += 4) {
+        const auto word = static_cast<uint32_t>(bs.readBits(32));
+        for (int i = 0; i < 4; i++) { payload[byte + i] = static_cast<uint8_t>(word >> (24 - 8 * i)); }
+    }
+    for (; byte < size; byte++) { payload[byte] = static_cast<uint8_t>(bs.readBits(8)); }
+    // Slot to symbol lookup, with the frequency and cumulative frequency of each symbol
+    constexpr uint32_t mask = (1u << PROB_BITS) - 1;
+    vector<uint8_t> slots(1u << PROB_BITS, 0);
+    vector<uint32_t> cumulative(SYMBOLS + 1, 0);
+    for (int s = 0; s < SYMBOLS; s++) {
+        cumulative[s + 1] = cumulative[s] + freqs[s];
+        if (cumulative[s + 1] > slots.size()) { throw runtime_error("Invalid rANS frequency table"); }
+        fill(slots.begin() + cumulative[s], slots.begin() + cumulative[s + 1], static_cast<uint8_t>(s));
+    }
+    const uint8_t *ptr = payload.data();
+    uint32_t states[STATES];
+    for (uint32_t &x: states) {
+        x = ptr[0] | ptr[1] << 8 | ptr[2] << 16 | static_cast<uint32_t>(ptr[3]) << 24;
+        ptr += 4;
+    }
+    // Reads bits that were coded with a total frequency of 2^bits
+    size_t step = 0;
+    auto bits = [&states, &step, &ptr](const int n) {
+        uint32_t &x = states[step++ % STATES];
+        const uint32_t value = x & ((1u << n) - 1);
+        x >>= n;
+        while (x < LOWER) { x = x << 8 | *ptr++; }
+        return value;
+    };
+    for (size_t i = 0; i < count; i++) {
+        uint32_t &x = states[step++ % STATES];
+        const uint32_t slot = x & mask;
+        const uint8_t symbol = slots[slot];
+        x = freqs[symbol] * (x >> PROB_BITS) + slot - cumulative[symbol];
+        while (x < LOWER) { x = x << 8 | *ptr++; }
+        if (symbol < ESCAPE) {
+            values[i] = unzigzag(symbol);
+            continue;
+        }
+        const int length = static_cast<int>(bits(LENGTH_BITS));
+        uint32_t extra = 0;
+        for (int shift = (length - 1) / CHUNK_BITS * CHUNK_BITS; length > 0 && shift >= 0; shift -= CHUNK_BITS) {
+            extra = extra << min(CHUNK_BITS, length - shift) | bits(min(CHUNK_BITS, length - shift));
+        }
+        values[i] = unzigzag(extra + ESCAPE);
+    }
+}
+
+int Rans::decode() { return values[position++]; }
+
+void Rans::decode_span(int *values_, const size_t count) {
+    copy(values.begin() + static_cast<ptrdiff_t>(position), values.begin() + static_cast<ptrdiff_t>(position + count), values_);
+    position += count;
+}
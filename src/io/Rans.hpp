@@ -0,0 +1,87 @@
+/** @file Rans.hpp
+ * @brief Header file for Rans class
+ * @ingroup io
+ * Declares the Rans class, a static rANS coder for blocks of ints
+*/
+
+#pragma once
+
+#include "BitStream.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The Rans class codes blocks of ints with static range asymmetric numeral systems
+ * @details Values given to encode are buffered, and write codes them as one block: the number of values, a frequency
+ * table fitted to them and the rANS payload. read decodes a whole block, whose values are then handed out in order by
+ * decode. Values are zigzag mapped to symbols, those from ESCAPE up are coded as ESCAPE followed by their bits.
+ * Consecutive symbols are coded by STATES interleaved states, so the decoder works on independent dependency chains.
+ */
+class Rans {
+public:
+    static constexpr int STATES = 4;              ///< Number of interleaved states
+    static constexpr int PROB_BITS = 12;          ///< The frequencies of a table add up to 2^PROB_BITS
+    static constexpr int SYMBOLS = 256;           ///< Size of the alphabet
+    static constexpr int ESCAPE = SYMBOLS - 1;    ///< Symbol of the values that are coded with their bits
+    static constexpr uint32_t LOWER = 1u << 23;   ///< Lower bound of a normalized state
+
+    //! Buffers an int to be coded by the next write
+    //! @param n the int
+    void encode(int n);
+
+    //! Buffers a run of ints to be coded by the next write
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int16_t *values, size_t count);
+
+    //! Buffers a run of ints to be coded by the next write
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int *values, size_t count);
+
+    //! Codes the buffered ints as one block and clears the buffer
+    //! @param bs BitStream to write to
+    void write(BitStream &bs);
+
+    //! Decodes a block written by write
+    //! @param bs BitStream to read from
+    void read(BitStream &bs);
+
+    //! Returns the next int of the block that was read
+    //! @return the decoded int
+    int decode();
+
+    //! Returns the next ints of the block that was read
+    //! @param values pointer to the first int to decode into
+    //! @param count number of ints
+    void decode_span(int *values, size_t count);
+
+private:
+    //! A step of the rANS coder: a symbol, or a group of bits of an escaped value
+    struct Operation {
+        uint16_t start;///< cumulative frequency of the symbol, or the bits
+        uint16_t freq; ///< frequency of the symbol, 1 for bits
+        uint8_t bits;  ///< log2 of the total frequency
+    };
+
+    std::vector<int> values;///< buffered ints when encoding, decoded ints when decoding
+    size_t position = 0;    ///< index of the next int to decode
+
+    //! Scales symbol counts to frequencies that add up to 2^PROB_BITS, keeping every used symbol
+    //! @param counts number of occurrences of each symbol
+    //! @param freqs the frequencies
+    static void normalize(const std::vector<uint32_t> &counts, std::vector<uint32_t> &freqs);
+
+    //! Writes a frequency table
+    //! @param bs BitStream to write to
+    //! @param freqs the frequencies
+    static void writeTable(BitStream &bs, const std::vector<uint32_t> &freqs);
+
+    //! Reads a frequency table written by writeTable
+    //! @param bs BitStream to read from
+    //! @param freqs the frequencies
+    static void readTable(BitStream &bs, std::vector<uint32_t> &freqs);
+
+    template<typename T>
+    void encodeSpan(const T *values, size_t count);
+};
@@ -0,0 +1,119 @@
+#include "Rice.hpp"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+Rice::Rice(BitStream *bis) {
+    bs = bis;
+}
+
+bool Rice::fits(const int m_) {
+    return m_ > 0 && (m_ & (m_ - 1)) == 0;
+}
+
+void Rice::set_m(const int m_) {
+    assert(fits(m_));
+    m = m_;
+    k = 0;
+    while ((1 << k) < m) { k++; }
+    mask = m - 1;
+}
+int Rice::get_m() const { return m; }
+BitStream *Rice::get_bs() const { return bs; }
+
+void Rice::set_limit(const int limit_) {
+    limit = max(limit_, 0);
+    escapeAt = limit > 0 ? limit : INT_MAX;
+}
+int Rice::get_limit() const { return limit; }
+
+int Rice::codeword(const int n, uint64_t &code) const {
+    const uint32_t sign = n < 0;
+    const uint32_t value = n < 0 ? -static_cast<uint32_t>(n) : n;
+    const uint32_t q = value >> k;
+    if (q >= static_cast<uint32_t>(escapeAt)) { return escapeCodeword(sign, value, limit, code); }
+    const int length = static_cast<int>(q) + k + 2;
+    const uint32_t ones = q < 32 ? q : 0;// Keeps the shifts defined, the code is unused then
+    code = static_cast<uint64_t>(sign) << (ones + k + 1) | ((uint64_t{1} << ones) - 1) << (k + 1) | (value & mask);
+    return length;
+}
+
+template<typename T>
+void Rice::encodeSpan(const T *values, const size_t count) const {
+    BitStream::Writer writer(*bs);
+    auto put = [this, &writer](const int n, const uint64_t code, const int length) {
+        if (length <= 32) {
+            writer.put(code, length);
+        } else {
+            writer.store();
+            encode(n);
+            writer.load();
+        }
+    };
+    size_t i = 0;
+    for (; i + 1 < count; i += 2) {
+        uint64_t first, second;
+        const int first_length = codeword(values[i], first);
+        const int second_length = codeword(values[i + 1], second);
+        if (first_length + second_length <= 32) {
+            writer.put(first << second_length | second, first_length + second_length);
+        } else {
+            put(values[i], first, first_length);
+            put(values[i + 1], second, second_length);
+        }
+    }
+    if (i < count) {
+        uint64_t code;
+        const int length = codeword(values[i], code);
+        put(values[i], code, length);
+    }
+}
+
+void Rice::encode_span(const int16_t *values, const size_t count) const { encodeSpan(values, count); }
+
+void Rice::encode_span(const int *values, const size_t count) const { encodeSpan(values, count); }
+
+void Rice::decode_span(int *values, const size_t count) {
+    BitStream::Reader reader(*bs);
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t window = reader.peek();
+        const int q = countLeadingZeros(~(window << 1));
+        int length = q + k + 2;
+        if (q >= escapeAt) {
+            length = resolveEscape(window, 32, limit, values[i]);
+            if (length > 0) {
+                reader.skip(length);
+                continue;
+            }
+        }
+        if (length > 32 || q >= escapeAt) {
+            reader.store();
+            values[i] = decodeLong();
+            reader.load();
+            continue;
+        }
+        reader.skip(length);
+        const int value = (q << k) | static_cast<int>(window >> (32 - length) & mask);
+        values[i] = (window >> 31) != 0 ? -value : value;
+    }
+}
+
+int Rice::decodeLong() {
+    const int sign = bs->readBit();
+    // The quotient is counted 31 ones at a time, up to the limit
+    int q = 0;
+    int run;
+    do {
+        run = min(countLeadingZeros(~static_cast<uint32_t>(bs->peekBits(31) << 1)), escapeAt - q);
+        q += run;
+        bs->skipBits(run);
+    } while (run == 31 && q < escapeAt);
+    if (q == escapeAt) {
+        const int magnitude = readEscape(bs);
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    bs->skipBits(1);
+    const int value = (q << k) | static_cast<int>(bs->readBits(k));
+    return sign != 0 ? -value : value;
+}
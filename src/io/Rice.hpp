@@ -0,0 +1,175 @@
+/** @file Rice.hpp
+ * @brief Header file for Rice class
+ * @ingroup io
+ * Declares the Rice class, a Golomb coder specialised for power-of-two m
+*/
+
+#pragma once
+
+#include "BitStream.hpp"
+#include "Golomb.hpp"
+#include <utility>
+
+/**
+ * @brief The Rice class encodes/decodes int values using Golomb coding with m = 2^k
+ * @details Produces exactly the same bits as Golomb for the same m, but the quotient and remainder are a shift and a
+ * mask, and the remainder never needs the extra truncated binary bit. A whole code is usually written or read with a
+ * single BitStream call.
+ */
+class Rice {
+    BitStream *bs;     ///< BitStream object
+    int m = -1;        ///< m parameter of golomb code
+    int k = -1;        ///< log2(m)
+    uint32_t mask = 0; ///< m - 1, selects the remainder
+    int limit = 0;     ///< quotient from which values are escaped, 0 if codes aren't limited
+    int escapeAt = INT_MAX;///< limit, or INT_MAX if codes aren't limited
+
+    //! Decodes a code that is longer than WINDOW_BITS, or escaped
+    //! @return the decoded int
+    int decodeLong();
+
+    //! Builds the code of an int without branching
+    //! @param n the int to encode
+    //! @param code the code, ending at the LSB (only valid if it fits in 32 bits)
+    //! @return the length of the code in bits
+    int codeword(int n, uint64_t &code) const;
+
+    //! Encodes and writes a run of ints
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    template<typename T>
+    void encodeSpan(const T *values, size_t count) const;
+
+public:
+    static constexpr int WINDOW_BITS = 16;///< Number of bits peeked to decode a code in one step
+
+    /**
+     * \brief Constructor for the Rice class
+     * \param bis BitStream object to use
+     */
+    explicit Rice(BitStream *bis);
+    /**
+     * \brief Checks whether m can be coded with a Rice coder
+     * \param m_ the m parameter of golomb code
+     * \return Whether m is a power of two
+     */
+    static bool fits(int m_);
+    /**
+     * \brief Sets the m parameter of golomb code
+     * \details Must be called before encode/decode
+     * \param m_ the m parameter of golomb code, a power of two
+     */
+    void set_m(int m_);
+    /**
+     * \brief Gets the m parameter of golomb code
+     * \return the m parameter of golomb code
+     */
+    int get_m() const;
+    /**
+     * \brief Gets the BitStream object
+     * \return BitStream object
+     */
+    BitStream *get_bs() const;
+    /**
+     * \brief Sets the quotient from which values are escaped
+     * \param limit_ the quotient limit, 0 for unlimited codes
+     */
+    void set_limit(int limit_);
+    /**
+     * \brief Gets the quotient from which values are escaped
+     * \return the quotient limit, 0 for unlimited codes
+     */
+    int get_limit() const;
+
+    //! Encodes and writes given int
+    //! @param n the int to encode
+    void encode(int n) const;
+
+    //! Reads and decodes a single int from file
+    //! @return the decoded int
+    int decode();
+
+    //! Encodes and writes a run of ints
+    //! @details Keeps the bit accumulator in registers for the whole run and writes pairs of short codes at once
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int16_t *values, size_t count) const;
+
+    //! Encodes and writes a run of ints
+    //! @param values pointer to the first int
+    //! @param count number of ints
+    void encode_span(const int *values, size_t count) const;
+
+    //! Reads and decodes a run of ints
+    //! @details Keeps the bit accumulator in registers for the whole run
+    //! @param values where to store the decoded ints
+    //! @param count number of ints to decode
+    void decode_span(int *values, size_t count);
+};
+
+/**
+ * \brief Runs f with the fastest golomb coder for m
+ * \details The coder is picked once for the whole stream, so the per-symbol calls in f are resolved at compile time
+ * \param bs BitStream object to use
+ * \param m the m parameter of golomb code
+ * \param limit the quotient limit of the codes, 0 for unlimited codes
+ * \param f generic callable, called with a Rice or Golomb coder
+ */
+template<typename F>
+void withGolombCoder(BitStream *bs, const int m, const int limit, F &&f) {
+    if (Rice::fits(m)) {
+        Rice rice(bs);
+        rice.set_limit(limit);
+        rice.set_m(m);
+        std::forward<F>(f)(rice);
+    } else {
+        Golomb golomb(bs);
+        golomb.set_limit(limit);
+        golomb.set_m(m);
+        std::forward<F>(f)(golomb);
+    }
+}
+
+/**
+ * \brief Runs f with the fastest golomb coder for m, without a quotient limit
+ * \param bs BitStream object to use
+ * \param m the m parameter of golomb code
+ * \param f generic callable, called with a Rice or Golomb coder
+ */
+template<typename F>
+void withGolombCoder(BitStream *bs, const int m, F &&f) {
+    withGolombCoder(bs, m, 0, std::forward<F>(f));
+}
+
+inline void Rice::encode(const int n) const {
+    const uint32_t sign = n < 0;
+    const uint32_t value = n < 0 ? -static_cast<uint32_t>(n) : n;
+    uint32_t q = value >> k;
+    const uint32_t r = value & mask;
+    const int length = static_cast<int>(q) + k + 2;
+    if (q >= static_cast<uint32_t>(escapeAt)) {
+        bs->writeBit(static_cast<int>(sign));
+        writeEscape(bs, value, limit);
+        return;
+    }
+    if (length <= BitStream::MAX_BITS) {
+        // Sign, q ones, the terminating zero and the remainder in a single write
+        bs->writeBits(static_cast<uint64_t>(sign) << (length - 1) | ((uint64_t{1} << q) - 1) << (k + 1) | r, length);
+        return;
+    }
+    bs->writeBit(static_cast<int>(sign));
+    for (; q >= 32; q -= 32) { bs->writeBits(0xFFFFFFFF, 32); }
+    bs->writeBits((uint64_t{1} << q) - 1, static_cast<int>(q));
+    bs->writeBits(r, k + 1);
+}
+
+inline int Rice::decode() {
+    // Most codes fit in a short window, which rarely needs a refill
+    const auto window = static_cast<uint32_t>(bs->peekBits(WINDOW_BITS)) << (32 - WINDOW_BITS);
+    const int q = countLeadingZeros(~(window << 1));
+    const int length = q + k + 2;
+    if (length > WINDOW_BITS || q >= escapeAt) { return decodeLong(); }
+    bs->skipBits(length);
+    const int value = (q << k) | static_cast<int>(window >> (32 - length) & mask);
+    return (window >> 31) != 0 ? -value : value;
+}
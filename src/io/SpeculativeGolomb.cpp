@@ -0,0 +1,130 @@
+#include "SpeculativeGolomb.hpp"
+#include "Golomb.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+constexpr size_t SpeculativeGolomb::PROBE;
+constexpr uint64_t SpeculativeGolomb::MIN_CHUNK_BITS;
+
+SpeculativeGolomb::SpeculativeGolomb(BitStream *bs, const int m, const int limit, const int threads,
+                                     const int candidates)
+    : bs(bs), m(m), limit(limit), threads(max(threads, 1)), candidates(max(candidates, 1)) {}
+
+void SpeculativeGolomb::decodeFrom(const uint8_t *data, const size_t size, const uint64_t start, const uint64_t stop,
+                                   const size_t count, Candidate &candidate) const {
+    candidate.end = start;
+    if (start >= static_cast<uint64_t>(size) * 8) { return; }
+    const uint64_t base = start / 8 * 8;
+    BitStream in(data + start / 8, size - start / 8);
+    in.skipBits(static_cast<int>(start % 8));
+    Golomb golomb(&in);
+    golomb.set_limit(limit);
+    golomb.set_m(m);
+    size_t window;
+    uint64_t bit;
+    try {
+        while (candidate.end < stop && candidate.values.size() < count) {
+            const int value = golomb.decode();
+            candidate.starts.push_back(candidate.end);
+            candidate.values.push_back(value);
+            in.readWindow(window, bit);
+            candidate.end = base + bit;
+        }
+    } catch (const runtime_error &) {
+        // A candidate that started in the middle of a code may read garbage up to the end of the stream
+    }
+}
+
+uint64_t SpeculativeGolomb::decodeChunks(const uint8_t *data, const size_t size, const uint64_t start,
+                                         const uint64_t stop, int *values, const size_t count,
+                                         size_t &decoded) const {
+    const uint64_t chunk = (stop - start) / threads;
+    const auto chunkEnd = [&](const int c) { return c + 1 == threads ? stop : start + (c + 1) * chunk; };
+
+    vector<Candidate> decodings(static_cast<size_t>(threads) * candidates);
+    const auto decodeTask = [&](const int task) {
+        const int c = task / candidates;
+        const int offset = task % candidates;
+        // The first chunk starts where the codes decoded so far end, so it needs no other candidate
+        if (c == 0 && offset > 0) { return; }
+        decodeFrom(data, size, start + c * chunk + offset, chunkEnd(c), count, decodings[task]);
+    };
+    const int tasks = threads * candidates;
+    const int team = threads;
+#pragma omp parallel for default(none) shared(decodeTask, tasks) num_threads(team) schedule(dynamic, 1)
+    for (int task = 0; task < tasks; task++) { decodeTask(task); }
+
+    // Finds a candidate of a chunk with a code starting at a position, whose codes are then the true ones
+    const auto find = [&](const int c, const uint64_t position, size_t &index) -> const Candidate * {
+        for (int offset = 0; offset < candidates; offset++) {
+            const Candidate &candidate = decodings[static_cast<size_t>(c) * candidates + offset];
+            const auto it = lower_bound(candidate.starts.begin(), candidate.starts.end(), position);
+            if (it != candidate.starts.end() && *it == position) {
+                index = it - candidate.starts.begin();
+                return &candidate;
+            }
+        }
+        return nullptr;
+    };
+
+    uint64_t position = start;
+    decoded = 0;
+    for (int c = 0; c < threads && decoded < count; c++) {
+        size_t index = 0;
+        const Candidate *synced = find(c, position, index);
+        if (synced == nullptr && position < chunkEnd(c)) {
+            // No candidate has reached the true codes yet, so they are decoded sequentially until one has
+            const uint64_t base = position / 8 * 8;
+            BitStream in(data + position / 8, size - position / 8);
+            in.skipBits(static_cast<int>(position % 8));
+            Golomb golomb(&in);
+            golomb.set_limit(limit);
+            golomb.set_m(m);
+            size_t window;
+            uint64_t bit;
+            while (decoded < count && position < chunkEnd(c) && (synced = find(c, position, index)) == nullptr) {
+                values[decoded++] = golomb.decode();
+                in.readWindow(window, bit);
+                position = base + bit;
+            }
+        }
+        if (synced != nullptr && decoded < count) {
+            const size_t n = min(synced->values.size() - index, count - decoded);
+            copy_n(synced->values.begin() + index, n, values + decoded);
+            decoded += n;
+            position = index + n == synced->values.size() ? synced->end : synced->starts[index + n];
+        }
+    }
+    return position;
+}
+
+void SpeculativeGolomb::decode_span(int *values, const size_t count) {
+    Golomb golomb(bs);
+    golomb.set_limit(limit);
+    golomb.set_m(m);
+    size_t size;
+    uint64_t start;
+    const uint8_t *data = bs->readWindow(size, start);
+    const size_t probe = min(count, PROBE);
+    golomb.decode_span(values, probe);
+    if (data == nullptr || threads == 1 || probe == count) {
+        golomb.decode_span(values + probe, count - probe);
+        return;
+    }
+
+    // The remaining codes are guessed to be as long as the probed ones, with a margin so that few are left over
+    uint64_t position;
+    bs->readWindow(size, position);
+    const double bits = static_cast<double>(position - start) / static_cast<double>(probe);
+    const auto guess = static_cast<uint64_t>(bits * static_cast<double>(count - probe) * 17 / 16);
+    const uint64_t stop = min(position + guess, static_cast<uint64_t>(size) * 8);
+    size_t decoded = 0;
+    if ((stop - position) / threads >= MIN_CHUNK_BITS) {
+        const uint64_t end = decodeChunks(data, size, position, stop, values + probe, count - probe, decoded);
+        // The stream is in memory, so it jumps past the decoded codes instead of reading through them
+        bs->seekBit(end);
+    }
+    golomb.decode_span(values + probe + decoded, count - probe - decoded);
+}
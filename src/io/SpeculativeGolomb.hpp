@@ -0,0 +1,80 @@
+/** @file SpeculativeGolomb.hpp
+ * @brief Header file for SpeculativeGolomb class
+ * @ingroup io
+ * Declares the SpeculativeGolomb class, which decodes a long run of Golomb codes on several threads
+*/
+
+#pragma once
+
+#include "BitStream.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The SpeculativeGolomb class decodes a long run of Golomb codes on several threads
+ * @details Golomb codes carry no sync markers, so a thread can't know where the codes of its part of the stream start.
+ * The bits the run should take are guessed from the codes decoded first and split into one chunk per thread, and every
+ * chunk is decoded from a few candidate bit offsets at once. A decoder started in the middle of a code reads garbage
+ * for a few codes, but soon lands on the start of a real one, after which it decodes exactly as the sequential decoder
+ * would. The chunks are then stitched in order: the codes of a candidate are kept from the first one that starts where
+ * the codes before it end, and the few codes before that are decoded again sequentially. The stream is unchanged, and
+ * the values are always the ones the sequential decoder would give.
+ * Only streams whose bytes are all in memory can be decoded this way (see BitStream::readWindow), the others are
+ * decoded sequentially.
+ */
+class SpeculativeGolomb {
+public:
+    static constexpr size_t PROBE = 4096;                ///< Number of codes decoded first, to guess their length
+    static constexpr uint64_t MIN_CHUNK_BITS = 1u << 16; ///< Runs with shorter chunks are decoded sequentially
+
+    /**
+     * \brief Constructor for the SpeculativeGolomb class
+     * \param bs BitStream to read from
+     * \param m the m parameter of the codes
+     * \param limit the quotient limit of the codes, 0 if they aren't limited
+     * \param threads number of threads, and so of chunks
+     * \param candidates number of offsets every chunk is decoded from
+     */
+    SpeculativeGolomb(BitStream *bs, int m, int limit, int threads, int candidates = 2);
+
+    //! Reads and decodes a run of ints
+    //! @param values where to store the decoded ints
+    //! @param count number of ints to decode
+    void decode_span(int *values, size_t count);
+
+private:
+    //! Codes decoded from a candidate offset
+    struct Candidate {
+        std::vector<uint64_t> starts;///< position of the first bit of every code
+        std::vector<int> values;     ///< decoded ints
+        uint64_t end = 0;            ///< position after the last code
+    };
+
+    BitStream *bs;  ///< BitStream object
+    int m;          ///< m parameter of golomb code
+    int limit;      ///< quotient from which values are escaped, 0 if codes aren't limited
+    int threads;    ///< number of threads
+    int candidates; ///< number of offsets every chunk is decoded from
+
+    //! Decodes codes from a bit offset until one starts at or past a position
+    //! @param data bytes of the stream
+    //! @param size number of bytes
+    //! @param start bit offset of the first code
+    //! @param stop position past which no code is started
+    //! @param count largest number of codes to decode
+    //! @param candidate where to store the codes
+    void decodeFrom(const uint8_t *data, size_t size, uint64_t start, uint64_t stop, size_t count,
+                    Candidate &candidate) const;
+
+    //! Decodes a run of codes from a bit offset, speculatively
+    //! @param data bytes of the stream
+    //! @param size number of bytes
+    //! @param start bit offset of the first code
+    //! @param stop guessed position of the end of the run
+    //! @param values where to store the decoded ints
+    //! @param count largest number of ints to decode
+    //! @param decoded set to the number of ints decoded
+    //! @return the position after the last decoded code
+    uint64_t decodeChunks(const uint8_t *data, size_t size, uint64_t start, uint64_t stop, int *values, size_t count,
+                          size_t &decoded) const;
+};
@@ -203,6 +203,20 @@ Image convert_BGR_GRAY(Image &im) {
     return result;
 }
 
+Image convert_YUV_GRAY(Image &im) {
+    Mat *matrix = im.get_image_mat();
+    if (matrix->channels() != 3) {
+        throw runtime_error("Original matrix must have 3 channels");
+    }
+    Mat channels[3];
+    split(*matrix, channels);
+    Image result;
+    result.set_image_mat(channels[0]);
+    result.set_color(GRAY);
+    result.set_chroma(NA);
+    return result;
+}
+
 void subsample(Image &im, const CHROMA_SUBSAMPLING cs) {
     Mat *matrix = im.get_image_mat();
     Mat channels[3];
@@ -40,6 +40,10 @@ Image convert_YUV_BGR(Image &im);
 //! @return Image converted from BGR to GRAY
 Image convert_BGR_GRAY(Image &im);
 
+//! Converts Image from YUV to GRAY, by keeping its Y channel
+//! @return Image converted from YUV to GRAY
+Image convert_YUV_GRAY(Image &im);
+
 //! Convert an Image from a higher YUV subsampling to a lower one
 //! @param im Image to be converted
 //! @param cs Chroma subsampling format
@@ -109,7 +109,8 @@ void Video::convert_to(const COLOR_SPACE f1, const COLOR_SPACE f2) {
                 case YUV:
                     break;
                 case GRAY:
-                    throw runtime_error("YUV to GRAY conversion not implemented");
+                    func = [](Image &im) { return convert_YUV_GRAY(im); };
+                    break;
             }
             break;
         case GRAY:
@@ -118,6 +119,11 @@ void Video::convert_to(const COLOR_SPACE f1, const COLOR_SPACE f2) {
     vector<Image> temp;
     for (auto &im: im_reel) { temp.push_back(func(im)); }
     im_reel = temp;
+    if (f2 == GRAY) {
+        // Saved as a monochrome y4m
+        header.color_space = NA;
+        header.raw_color_space = "-";
+    }
 }
 
 void Video::from_encoder(const Header &header) {
@@ -125,7 +131,8 @@ void Video::from_encoder(const Header &header) {
     this->header.height = static_cast<int>(header.height);
     this->header.fps_num = header.fps_num;
     this->header.fps_den = header.fps_den;
-    this->header.color_space = header.chroma_subsampling;
+    // Only GRAY frames are saved as monochrome, whatever their chroma subsampling says
+    this->header.color_space = header.color_space == GRAY ? NA : header.chroma_subsampling;
 }
 
 // ReSharper disable once CppMemberFunctionMayBeConst
@@ -140,6 +147,11 @@ void Video::save(const char *filename) {
 void Video::save_y4m(const char *filename, const Header &header) {
     const string ext = filename;
     from_encoder(header);
+    if (header.color_space == BGR) {
+        // Y4M has no BGR format, so BGR frames are saved as 4:4:4 YUV
+        for (auto &im: im_reel) { im = convert_BGR_YUV444(im); }
+        this->header.color_space = YUV444;
+    }
     YuvWriter writer(filename, this->header);
     writer.write_video(*this);
 }
@@ -147,16 +159,24 @@ void Video::save_y4m(const char *filename, const Header &header) {
 double Video::compare(Video &other) const {
     if (loaded() && other.loaded()) {
         if (im_reel.size() != other.get_reel().size()) { return INFINITY; }
-        auto mse = [](const Image &im1, const Image &im2) {
+        auto mse = [](Image im1, Image im2) {
+            // Rows are read as runs of samples, so that frames of any number of channels compare alike
+            const Mat &mat1 = *im1.get_image_mat();
+            const Mat &mat2 = *im2.get_image_mat();
+            if (mat1.size() != mat2.size() || mat1.channels() != mat2.channels()) {
+                throw runtime_error("Frames differ in size or channels");
+            }
+            const int samples = mat1.cols * mat1.channels();
             double sum = 0;
-            for (int i = 0; i < im1.size().height; i++) {
-                for (int j = 0; j < im1.size().width; j++) {
-                    auto p1 = im1.getPixel(i, j);
-                    auto p2 = im2.getPixel(i, j);
-                    sum += pow(p1[0] - p2[0], 2) + pow(p1[1] - p2[1], 2) + pow(p1[2] - p2[2], 2);
+            for (int i = 0; i < mat1.rows; i++) {
+                const uchar *row1 = mat1.ptr<uchar>(i);
+                const uchar *row2 = mat2.ptr<uchar>(i);
+                for (int j = 0; j < samples; j++) {
+                    const int diff = row1[j] - row2[j];
+                    sum += diff * diff;
                 }
             }
-            return sum / (im1.size().height * im1.size().width);
+            return sum / (mat1.rows * mat1.cols);
         };
         auto psnr = [](const double mse_result) -> double {
             if (mse_result == 0) return INFINITY;
@@ -114,6 +114,7 @@ public:
 
     /**
      * @brief Write Video to file as Y4M
+     * @details GRAY frames are saved as Cmono, and BGR frames are converted to 4:4:4 YUV
      * @param filename path to the file
      * @param header Decoder header
      */
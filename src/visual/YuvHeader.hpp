@@ -47,6 +47,11 @@ inline void get_adjusted_dims(const YuvHeader &header, int *uvWidth, int *uvHeig
             *uvWidth = width / 2;
             *uvHeight = height / 2;
             break;
+        case NA:
+            // Monochrome, there are no U and V planes
+            *uvWidth = 0;
+            *uvHeight = 0;
+            break;
         default:
             throw std::runtime_error("Unrecognised UV format");
     }
@@ -77,7 +77,9 @@ void YuvParser::parse_header() {
     }
     const string color_space = this->header.raw_color_space;
     this->header.color_space = YUV420;
-    if (color_space.find("422") != string::npos) {
+    if (color_space.find("mono") != string::npos) {
+        this->header.color_space = NA;
+    } else if (color_space.find("422") != string::npos) {
         this->header.color_space = YUV422;
     } else if (color_space.find("444") != string::npos) {
         this->header.color_space = YUV444;
@@ -123,7 +125,9 @@ Video YuvParser::load_y4m() {
 Image YuvParser::read_image(const int uvWidth, const int uvHeight) const {
     Image im;
     char buffer[6];
-    im.set_color(YUV);
+    // Monochrome files only have the Y plane
+    const bool mono = this->header.color_space == NA;
+    im.set_color(mono ? GRAY : YUV);
     im.set_chroma(this->header.color_space);
     const int width = this->header.width;
     const int height = this->header.height;
@@ -149,6 +153,10 @@ Image YuvParser::read_image(const int uvWidth, const int uvHeight) const {
               width * height, file) != width * height) {
         throw runtime_error("yPlane reading not completed");
     }
+    if (mono) {
+        im.set_image_mat(yPlane);
+        return im;
+    }
     if (fread(uPlane.data, sizeof(uint8_t),
               uvWidth * uvHeight, file) != uvWidth * uvHeight) {
         throw runtime_error("uPlane reading not completed");
@@ -30,14 +30,14 @@ void YuvWriter::write_header() const {
     }
     if (header.raw_color_space[0] != '-') {
         fprintf(file, " %s", header.raw_color_space.c_str());
-    } else if (header.color_space != NA) {
-        if (header.color_space == YUV444) {
-            fprintf(file, " C444");
-        } else if (header.color_space == YUV422) {
-            fprintf(file, " C422");
-        } else if (header.color_space == YUV420) {
-            fprintf(file, " C420");
-        }
+    } else if (header.color_space == NA) {
+        fprintf(file, " Cmono");
+    } else if (header.color_space == YUV444) {
+        fprintf(file, " C444");
+    } else if (header.color_space == YUV422) {
+        fprintf(file, " C422");
+    } else if (header.color_space == YUV420) {
+        fprintf(file, " C420");
     }
     fprintf(file, "\n");
 }
@@ -49,6 +49,18 @@ void YuvWriter::write_image(Image &image) const {
     int uvWidth, uvHeight;
     get_adjusted_dims(header, &uvWidth, &uvHeight);
     const Mat image_mat = *image.get_image_mat();
+    if ((image_mat.channels() == 1) != (header.color_space == NA)) {
+        throw runtime_error("Frame channel count does not match the Y4M color space");
+    }
+    if (image_mat.channels() == 1) {
+        // Monochrome frames are the Y plane alone
+        for (int row = 0; row < height; row++) {
+            if (fwrite(image_mat.ptr<uchar>(row), sizeof(uchar), width, file) != static_cast<size_t>(width)) {
+                throw runtime_error("Error writing Y plane");
+            }
+        }
+        return;
+    }
     vector<Mat> planes;
     split(image_mat, planes);
     const Mat yPlane = planes[0];
@@ -58,13 +70,15 @@ void YuvWriter::write_image(Image &image) const {
         resize(uPlane, uPlane, Size(uvWidth, uvHeight));
         resize(vPlane, vPlane, Size(uvWidth, uvHeight));
     }
-    if (fwrite(yPlane.data, sizeof(uchar), width * height, file) != width * height) {
+    const size_t ySize = static_cast<size_t>(width) * height;
+    const size_t uvSize = static_cast<size_t>(uvWidth) * uvHeight;
+    if (fwrite(yPlane.data, sizeof(uchar), ySize, file) != ySize) {
         throw runtime_error("Error writing Y plane");
     }
-    if (fwrite(uPlane.data, sizeof(uchar), uvWidth * uvHeight, file) != uvWidth * uvHeight) {
+    if (fwrite(uPlane.data, sizeof(uchar), uvSize, file) != uvSize) {
         throw runtime_error("Error writing U plane");
     }
-    if (fwrite(vPlane.data, sizeof(uchar), uvWidth * uvHeight, file) != uvWidth * uvHeight) {
+    if (fwrite(vPlane.data, sizeof(uchar), uvSize, file) != uvSize) {
         throw runtime_error("Error writing V plane");
     }
 }
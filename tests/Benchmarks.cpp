@@ -0,0 +1,115 @@
+#include "../src/codec/Frame.hpp"
+#include "../src/io/Cabac.hpp"
+#include "../src/io/Golomb.hpp"
+#include "../src/io/GolombEstimator.hpp"
+#include "../src/visual/Video.hpp"
+#include <chrono>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <iostream>
+
+using namespace std;
+
+class CoderBenchmark : public ::testing::Test {
+protected:
+    const char *small_still = "../../tests/resource/akiyo_qcif.y4m";
+    const char *small_moving = "../../tests/resource/coastguard_qcif.y4m";
+
+    //! Intra residuals of every frame of a video, in coding order
+    static vector<int> residuals(const char *path) {
+        const Video vid(path);
+        vector<int> result;
+        for (Frame *frame: vid.generate_frames()) {
+            frame->encode_JPEG_LS();
+            const vector<int> &encoding = frame->get_intra_encoding();
+            result.insert(result.end(), encoding.begin(), encoding.end());
+            delete frame;
+        }
+        return result;
+    }
+
+    //! Encodes the values one by one and returns the rate in symbols per second
+    static double encode_rate(const vector<int> &values, const int m, const int range, BitStream &bs) {
+        Golomb g(&bs);
+        g.set_encode_range(range);
+        g.set_m(m);
+        const auto start = chrono::steady_clock::now();
+        for (const int n: values) { g.encode(n); }
+        bs.flushBuffer();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        return static_cast<double>(values.size()) / elapsed.count();
+    }
+
+    //! Seconds taken by a callable
+    template<typename F>
+    static double seconds(F &&f) {
+        const auto start = chrono::steady_clock::now();
+        f();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    //! Prints the size of a coded video in bits per pixel, and the rate of its samples in MB/s
+    static void report(const char *name, const size_t bytes, const vector<int> &values, const double encode,
+                       const double decode) {
+        // Every pixel has 3 samples of one byte
+        const double pixels = static_cast<double>(values.size()) / 3;
+        cout << "  " << name << ": " << static_cast<double>(bytes) * 8 / pixels << " bpp, encode "
+             << static_cast<double>(values.size()) / encode / 1e6 << " MB/s, decode "
+             << static_cast<double>(values.size()) / decode / 1e6 << " MB/s" << endl;
+    }
+};
+
+TEST_F(CoderBenchmark, GolombEncodeTable) {
+    for (const char *file: {small_still, small_moving}) {
+        const vector<int> values = residuals(file);
+        for (const int m: {3, 5, 6}) {
+            BitStream before;
+            BitStream after;
+            const double computed = encode_rate(values, m, 0, before);
+            const double table = encode_rate(values, m, Golomb::DEFAULT_ENCODE_RANGE, after);
+            ASSERT_EQ(before.size(), after.size());
+            ASSERT_EQ(memcmp(before.data(), after.data(), after.size()), 0);
+            cout << file << " m = " << m << ": " << computed / 1e6 << " -> " << table / 1e6 << " Msymbols/s" << endl;
+        }
+    }
+}
+
+TEST_F(CoderBenchmark, CabacAgainstGolomb) {
+    for (const char *file: {small_still, small_moving}) {
+        const vector<int> values = residuals(file);
+        vector<int> decoded(values.size());
+        cout << file << endl;
+        // Golomb with the best m for the whole video
+        GolombEstimator estimator;
+        estimator.add_span(values.data(), values.size());
+        BitStream golomb_stream;
+        Golomb encoder(&golomb_stream);
+        encoder.set_m(estimator.best_m());
+        const double golomb_encode = seconds([&] {
+            encoder.encode_span(values.data(), values.size());
+            golomb_stream.flushBuffer();
+        });
+        BitStream golomb_in(golomb_stream.data(), golomb_stream.size());
+        Golomb decoder(&golomb_in);
+        decoder.set_m(estimator.best_m());
+        const double golomb_decode = seconds([&] { decoder.decode_span(decoded.data(), decoded.size()); });
+        ASSERT_EQ(decoded, values);
+        report("Golomb", golomb_stream.size(), values, golomb_encode, golomb_decode);
+        // CABAC, adapting to the video as it goes
+        BitStream cabac_stream;
+        Cabac cabac;
+        const double cabac_encode = seconds([&] {
+            cabac.encode_span(values.data(), values.size());
+            cabac.write(cabac_stream);
+            cabac_stream.flushBuffer();
+        });
+        BitStream cabac_in(cabac_stream.data(), cabac_stream.size());
+        const double cabac_decode = seconds([&] {
+            cabac.read(cabac_in);
+            cabac.decode_span(decoded.data(), decoded.size());
+        });
+        ASSERT_EQ(decoded, values);
+        report("CABAC", cabac_stream.size(), values, cabac_encode, cabac_decode);
+    }
+}
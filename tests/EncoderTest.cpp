@@ -1,7 +1,11 @@
 #include "../src/codec/encoders/lossless/LosslessInter.hpp"
 #include "../src/codec/encoders/lossless/LosslessIntra.hpp"
 #include "../src/codec/encoders/lossless/LosslessHybrid.hpp"
+#include "../src/codec/encoders/lossy/LossyHybrid.hpp"
+#include "../src/codec/encoders/lossy/LossyIntra.hpp"
 #include "../src/visual/Video.hpp"
+#include <atomic>
+#include <cstdio>
 #include <gtest/gtest.h>
 
 using namespace std;
@@ -12,8 +16,64 @@ protected:
     string small_still = "../../tests/resource/akiyo_qcif.y4m";
     string small_moving = "../../tests/resource/coastguard_qcif.y4m";
     string test_video = "../../tests/resource/ducks_take_off_444_720p50.y4m";
+    string mono_video = "../../tests/resource/mono.y4m";
     void SetUp() override {
     }
+
+    //! Writes a short Cmono Y4M with a gradient that moves one pixel per frame, or with flat frames
+    void write_mono_video(const int width, const int height, const int count, const bool flat = false) const {
+        FILE *file = fopen(mono_video.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        fprintf(file, "YUV4MPEG2 W%d H%d F25:1 Ip A0:0 Cmono\n", width, height);
+        vector<uchar> plane(static_cast<size_t>(width) * height);
+        for (int i = 0; i < count; i++) {
+            for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                    plane[row * width + col] = static_cast<uchar>(flat ? 100 + i : (row + col + i) * 4 % 256);
+                }
+            }
+            fprintf(file, "FRAME\n");
+            fwrite(plane.data(), 1, plane.size(), file);
+        }
+        fclose(file);
+    }
+
+    //! Reconstructs the frames of a video as the lossy intra encoder does while encoding them in slices and tiles
+    static vector<Frame *> lossy_intra_reconstruction(const char *file, const uint8_t y, const uint8_t u, const uint8_t v,
+                                                      const int slices = 1, const int tiles = 1) {
+        const auto frames = Video(file).generate_frames();
+        LossyIntraEncoder encoder(file, nullptr, 0, y, u, v);
+        encoder.entropy_coder = CABAC;
+        for (const auto frame: frames) {
+            Image image = frame->get_image();
+            const cv::Mat *mat = image.get_image_mat();
+            BitStream scratch;
+            encoder.encode_intra_slices(*frame, scratch, Slices(mat->cols, mat->rows, slices, tiles));
+        }
+        return frames;
+    }
+
+    //! Checks that the decoded Y4M is still Cmono and within tolerance of the source, frame by frame
+    void check_mono_output(const int tolerance) const {
+        Video source(mono_video.c_str());
+        Video decoded("../../tests/resource/decoded");
+        ASSERT_EQ(decoded.get_header().color_space, NA);
+        auto source_reel = source.get_reel();
+        auto decoded_reel = decoded.get_reel();
+        ASSERT_EQ(decoded_reel.size(), source_reel.size());
+        for (size_t i = 0; i < source_reel.size(); i++) {
+            const cv::Mat im1 = *source_reel[i].get_image_mat();
+            const cv::Mat im2 = *decoded_reel[i].get_image_mat();
+            ASSERT_EQ(im2.channels(), 1);
+            ASSERT_EQ(im2.rows, im1.rows);
+            ASSERT_EQ(im2.cols, im1.cols);
+            for (int row = 0; row < im1.rows; row++) {
+                for (int col = 0; col < im1.cols; col++) {
+                    ASSERT_LE(abs(im1.at<uchar>(row, col) - im2.at<uchar>(row, col)), tolerance);
+                }
+            }
+        }
+    }
 };
 
 TEST_F(EncoderTest, HybridTest) {
@@ -31,6 +91,58 @@ TEST_F(EncoderTest, HybridTest) {
     }
 }
 
+TEST_F(EncoderTest, HybridTestSlices) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessHybridEncoder(file, "../../tests/resource/encoded", m, 16, 5);
+    encoder.slices = 4;
+    encoder.encode();
+    auto decoder = LosslessHybridEncoder("../../tests/resource/encoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, HybridTestTiles) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessHybridEncoder(file, "../../tests/resource/encoded", m, 16, 5);
+    encoder.slices = 2;
+    encoder.tiles = 3;
+    encoder.encode();
+    auto decoder = LosslessHybridEncoder("../../tests/resource/encoded");
+    decoder.decode();
+    ASSERT_EQ(decoder.header.tiles, 3);
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, HybridTestTemporal) {
+    constexpr int m = 0;
+    const char *file = small_still.c_str();
+    auto encoder = LosslessHybridEncoder(file, "../../tests/resource/encoded", m, 16, 255);
+    encoder.temporal = true;
+    encoder.slices = 2;
+    encoder.tiles = 2;
+    encoder.encode();
+    auto decoder = LosslessHybridEncoder("../../tests/resource/encoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
 TEST_F(EncoderTest, HybridTestAutoGolomb) {
     constexpr int m = 0;
     const char *file = test_video.c_str();
@@ -46,6 +158,22 @@ TEST_F(EncoderTest, HybridTestAutoGolomb) {
     }
 }
 
+TEST_F(EncoderTest, InterTest) {
+    constexpr int m = 0;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessInterFrameEncoder(file, "../../tests/resource/encoded", m, 16);
+    encoder.encode();
+    auto decoder = LosslessInterFrameEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+    decoder.decode();
+    ASSERT_EQ(decoder.header.block_size, 16);
+    const auto video_frames = Video(file).generate_frames();
+    ASSERT_EQ(decoder.frames.size(), video_frames.size());
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
 
 TEST_F(EncoderTest, IntraTest) {
     constexpr int m = 0;
@@ -60,4 +188,222 @@ TEST_F(EncoderTest, IntraTest) {
         Image im2 = decoder.frames[i].get_image();
         ASSERT_TRUE(im1 == im2);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(EncoderTest, IntraTestFixedGolomb) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessIntraEncoder(file, "../../tests/resource/encoded", m);
+    encoder.encode();
+    auto decoder = LosslessIntraEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, IntraTestWriteQueue) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessIntraEncoder(file, "../../tests/resource/encoded", m);
+    encoder.write_queue = 2;
+    encoder.encode();
+    auto decoder = LosslessIntraEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, EncodeInOrderTest) {
+    // With more frames than threads, a thread only takes another frame once it wrote its last one, so the last frame
+    // is encoded after the first one was written
+    constexpr size_t count = 256;
+    atomic<size_t> written{0};
+    vector<size_t> written_before(count);
+    vector<size_t> order;
+    encodeInOrder(
+            count,
+            [&written, &written_before](const size_t index, BitStream &stream) {
+                written_before[index] = written;
+                stream.writeBits(static_cast<int>(index), 8);
+            },
+            [&written, &order](BitStream &stream) {
+                stream.flushBuffer();
+                order.push_back(stream.data()[0]);
+                written++;
+            });
+    ASSERT_GT(written_before[count - 1], 0);
+    ASSERT_EQ(order.size(), count);
+    for (size_t i = 0; i < count; i++) { ASSERT_EQ(order[i], i); }
+}
+
+TEST_F(EncoderTest, IntraTestBlockPredictors) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessIntraEncoder(file, "../../tests/resource/encoded", m);
+    encoder.block_predictors = true;
+    encoder.encode();
+    auto decoder = LosslessIntraEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, IntraTestWavefront) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LosslessIntraEncoder(file, "../../tests/resource/encoded", m);
+    encoder.wavefront = true;
+    encoder.encode();
+    auto decoder = LosslessIntraEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+    decoder.decode();
+    const auto video_frames = Video(file).generate_frames();
+    for (int i = 0; i < video_frames.size(); i++) {
+        Image im1 = video_frames[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, MonoRoundTripTest) {
+    write_mono_video(64, 48, 6);
+    const char *file = mono_video.c_str();
+    {
+        auto encoder = LosslessIntraEncoder(file, "../../tests/resource/encoded", 4);
+        encoder.encode();
+        auto decoder = LosslessIntraEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+        decoder.decode();
+        check_mono_output(0);
+    }
+    {
+        auto encoder = LosslessHybridEncoder(file, "../../tests/resource/encoded", 4, 16, 3);
+        encoder.encode();
+        auto decoder = LosslessHybridEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+        decoder.decode();
+        check_mono_output(0);
+    }
+    {
+        auto encoder = LossyHybridEncoder(file, "../../tests/resource/encoded", 4, 16, 3, 255, 255, 255);
+        encoder.encode();
+        auto decoder = LossyHybridEncoder("../../tests/resource/encoded", "../../tests/resource/decoded");
+        decoder.decode();
+        check_mono_output(2);
+    }
+}
+
+TEST_F(EncoderTest, LossyIntraTest) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    auto encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", m, 4, 8, 8);
+    encoder.encode();
+    auto decoder = LossyIntraEncoder("../../tests/resource/encoded");
+    decoder.decode();
+    const auto reconstructed = lossy_intra_reconstruction(file, 4, 8, 8);
+    ASSERT_EQ(decoder.frames.size(), reconstructed.size());
+    for (size_t i = 0; i < reconstructed.size(); i++) {
+        Image im1 = reconstructed[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, LossyIntraTestCabac) {
+    const char *file = test_video.c_str();
+    auto encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", 0, 4, 8, 8);
+    encoder.entropy_coder = CABAC;
+    encoder.encode();
+    auto decoder = LossyIntraEncoder("../../tests/resource/encoded");
+    decoder.decode();
+    const auto reconstructed = lossy_intra_reconstruction(file, 4, 8, 8);
+    ASSERT_EQ(decoder.frames.size(), reconstructed.size());
+    for (size_t i = 0; i < reconstructed.size(); i++) {
+        Image im1 = reconstructed[i]->get_image();
+        Image im2 = decoder.frames[i].get_image();
+        ASSERT_TRUE(im1 == im2);
+    }
+}
+
+TEST_F(EncoderTest, LossyIntraTestRunMode) {
+    // Without run mode every sample takes at least a bit, flat frames are mostly coded as one run per row
+    constexpr int width = 64, height = 48, count = 6;
+    write_mono_video(width, height, count, true);
+    const char *file = mono_video.c_str();
+    for (const auto coder: {GOLOMB, CABAC}) {
+        auto encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", 2, 8, 8, 8);
+        encoder.entropy_coder = coder;
+        encoder.encode();
+        FILE *encoded = fopen("../../tests/resource/encoded", "rb");
+        ASSERT_NE(encoded, nullptr);
+        fseek(encoded, 0, SEEK_END);
+        ASSERT_LT(ftell(encoded), count * width * height / 8);
+        fclose(encoded);
+        auto decoder = LossyIntraEncoder("../../tests/resource/encoded");
+        decoder.decode();
+        const auto reconstructed = lossy_intra_reconstruction(file, 8, 8, 8);
+        ASSERT_EQ(decoder.frames.size(), reconstructed.size());
+        for (size_t i = 0; i < reconstructed.size(); i++) {
+            Image im1 = reconstructed[i]->get_image();
+            Image im2 = decoder.frames[i].get_image();
+            ASSERT_TRUE(im1 == im2);
+        }
+    }
+}
+
+TEST_F(EncoderTest, LossyIntraTestWavefront) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    for (const auto coder: {GOLOMB, CABAC}) {
+        auto sequential_encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", m, 4, 8, 8);
+        sequential_encoder.entropy_coder = coder;
+        sequential_encoder.encode();
+        auto sequential = LossyIntraEncoder("../../tests/resource/encoded");
+        sequential.decode();
+        auto encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", m, 4, 8, 8);
+        encoder.entropy_coder = coder;
+        encoder.wavefront = true;
+        encoder.encode();
+        auto decoder = LossyIntraEncoder("../../tests/resource/encoded");
+        decoder.decode();
+        ASSERT_TRUE(decoder.header.wavefront);
+        ASSERT_EQ(decoder.frames.size(), sequential.frames.size());
+        for (size_t i = 0; i < sequential.frames.size(); i++) {
+            Image im1 = sequential.frames[i].get_image();
+            Image im2 = decoder.frames[i].get_image();
+            ASSERT_TRUE(im1 == im2);
+        }
+    }
+}
+
+TEST_F(EncoderTest, LossyIntraTestTiles) {
+    constexpr int m = 4;
+    const char *file = test_video.c_str();
+    const auto reconstructed = lossy_intra_reconstruction(file, 4, 8, 8, 3, 2);
+    for (const auto coder: {GOLOMB, CABAC}) {
+        auto encoder = LossyIntraEncoder(file, "../../tests/resource/encoded", m, 4, 8, 8);
+        encoder.entropy_coder = coder;
+        encoder.slices = 3;
+        encoder.tiles = 2;
+        encoder.encode();
+        auto decoder = LossyIntraEncoder("../../tests/resource/encoded");
+        decoder.decode();
+        ASSERT_EQ(decoder.header.slices, 3);
+        ASSERT_EQ(decoder.header.tiles, 2);
+        ASSERT_EQ(decoder.frames.size(), reconstructed.size());
+        for (size_t i = 0; i < reconstructed.size(); i++) {
+            Image im1 = reconstructed[i]->get_image();
+            Image im2 = decoder.frames[i].get_image();
+            ASSERT_TRUE(im1 == im2);
+        }
+    }
+}
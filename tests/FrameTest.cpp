@@ -1,5 +1,10 @@
+#include "../src/codec/ColorTransform.hpp"
 #include "../src/codec/Frame.hpp"
+#include "../src/codec/GolombParameters.hpp"
+#include "../src/codec/IntraPredictor.hpp"
+#include "../src/codec/MedKernel.hpp"
 #include "../src/visual/Image.hpp"
+#include "../src/visual/ImageProcessing.hpp"
 #include "../src/visual/Video.hpp"
 #include <gtest/gtest.h>
 
@@ -31,6 +36,58 @@ TEST_F(FrameTest, IntraFrameTest) {
     ASSERT_TRUE(im1 == im2);
 }
 
+TEST_F(FrameTest, LocoIFrameTest) {
+    BitStream bs;
+    f1.encode_LOCO_I(bs);
+    bs.flushBuffer();
+    Header header{};
+    header.extract_info(f1);
+    BitStream in(bs.data(), bs.size());
+    const Frame decoded = Frame::decode_LOCO_I(in, header);
+    const Image im1 = f1.get_image();
+    Image im2 = decoded.get_image();
+    ASSERT_TRUE(im1 == im2);
+}
+
+TEST_F(FrameTest, LocoIRunModeTest) {
+    // Flat areas are coded in run mode, the noisy stripe in regular mode
+    cv::Mat mat(64, 96, CV_8UC3, cv::Scalar(16, 128, 128));
+    cv::randu(mat(cv::Rect(40, 0, 17, 64)), cv::Scalar::all(0), cv::Scalar::all(256));
+    mat(cv::Rect(0, 20, 96, 5)).setTo(cv::Scalar(200, 90, 30));
+    Frame frame{Image(mat)};
+    BitStream bs;
+    frame.encode_LOCO_I(bs);
+    bs.flushBuffer();
+    Header header{};
+    header.extract_info(frame);
+    BitStream in(bs.data(), bs.size());
+    const Frame decoded = Frame::decode_LOCO_I(in, header);
+    const Image im1 = frame.get_image();
+    Image im2 = decoded.get_image();
+    ASSERT_TRUE(im1 == im2);
+}
+
+TEST_F(FrameTest, MedKernelTest) {
+    // The branch-free median picks the same prediction as the edge cases of JPEG-LS
+    for (int a = 0; a < 256; a += 3) {
+        for (int b = 0; b < 256; b += 5) {
+            for (int c = 0; c < 256; c++) {
+                const int expected = c >= std::max(a, b) ? std::min(a, b) : c <= std::min(a, b) ? std::max(a, b) : a + b - c;
+                ASSERT_EQ(med(a, b, c), expected) << a << " " << b << " " << c;
+            }
+        }
+    }
+    // Single channel frames use their own kernel
+    cv::Mat mat(37, 53, CV_8UC1);
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(256));
+    Image image(mat);
+    image.set_color(GRAY);
+    Frame frame{image};
+    frame.encode_JPEG_LS();
+    const Frame decoded = Frame::decode_JPEG_LS(frame.get_intra_encoding(), GRAY, image.get_chroma(), 37, 53);
+    Image im2 = decoded.get_image();
+    ASSERT_TRUE(image == im2);
+}
 TEST_F(FrameTest, InterFrameTest) {
     f1.calculate_MV(f2, 16, 7, false);
     const Frame reconstruct = Frame::reconstruct_frame(f2, f1.get_motion_vectors(), 16);
@@ -39,6 +96,34 @@ TEST_F(FrameTest, InterFrameTest) {
     ASSERT_TRUE(im1 == im2);
 }
 
+TEST_F(FrameTest, GrayInterFrameTest) {
+    // Luma only frames go through motion compensation and the bitstream with one channel
+    Image luma1 = f1.get_image();
+    Image luma2 = f2.get_image();
+    Frame gray1{convert_YUV_GRAY(luma1)};
+    Frame gray2{convert_YUV_GRAY(luma2)};
+    gray1.calculate_MV(gray2, 16, 7, true);
+    gray1.setType(P_FRAME);
+    ASSERT_EQ(gray1.get_motion_vectors()[0].residual.type(), CV_16SC1);
+    const Image image = gray1.get_image();
+    Image reconstructed = Frame::reconstruct_frame(gray2, gray1.get_motion_vectors(), 16).get_image();
+    ASSERT_TRUE(image == reconstructed);
+    InterHeader header{};
+    header.width = image.size().width;
+    header.height = image.size().height;
+    header.color_space = GRAY;
+    header.entropy_coder = CABAC;
+    header.block_size = 16;
+    BitStream bs;
+    gray1.write_frame(bs, CABAC, GolombParameters(), 0);
+    bs.flushBuffer();
+    BitStream in(bs.data(), bs.size());
+    const Frame decoded = Frame::read_frame(in, header, Slices(header.width, header.height, 1, 1, 16), &gray2);
+    Image im2 = decoded.get_image();
+    ASSERT_EQ(im2.get_image_mat()->channels(), 1);
+    ASSERT_TRUE(image == im2);
+}
+
 TEST_F(FrameTest, InterFrameTestFast) {
     const auto comparator = new Block::SAD();
     comparator->threshold = 512;
@@ -48,4 +133,89 @@ TEST_F(FrameTest, InterFrameTestFast) {
     const Image im1 = f1.get_image();
     Image im2 = reconstruct.get_image();
     ASSERT_TRUE(im1 == im2);
-}
\ No newline at end of file
+}
+
+TEST_F(FrameTest, PredictorKernelTest) {
+    cv::Mat mat(37, 53, CV_8UC3);
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(256));
+    const int row_size = mat.cols * 3;
+    vector<int> residuals(row_size), med_residuals(row_size);
+    for (int predictor = 0; predictor < INTRA_PREDICTORS; predictor++) {
+        cv::Mat decoded(mat.rows, mat.cols, CV_8UC3);
+        for (int r = 0; r < mat.rows; r++) {
+            const uchar *above = r > 0 ? mat.ptr<uchar>(r - 1) : nullptr;
+            const uchar *decoded_above = r > 0 ? decoded.ptr<uchar>(r - 1) : nullptr;
+            // Rows are split into columns the way blocks split them
+            withPredictorKernel(3, static_cast<INTRA_PREDICTOR>(predictor), [&](auto kernel) {
+                kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, 0, 16, residuals.data());
+                kernel.residuals(mat.ptr<uchar>(r), above, mat.cols, 16, mat.cols, residuals.data());
+                kernel.reconstruct(decoded.ptr<uchar>(r), decoded_above, mat.cols, 0, mat.cols,
+                                   [&residuals](const int i, const int predicted) {
+                                       return static_cast<uchar>(predicted + residuals[i]);
+                                   });
+            });
+            if (predictor == PREDICT_MED) {
+                MedKernel<3>::residuals(mat.ptr<uchar>(r), above, mat.cols, med_residuals.data());
+                ASSERT_EQ(residuals, med_residuals);
+            }
+        }
+        Image im1(mat), im2(decoded);
+        ASSERT_TRUE(im1 == im2) << predictor;
+    }
+}
+
+TEST_F(FrameTest, ColorTransformTest) {
+    // YCoCg-R undoes itself on any residuals, not only on samples
+    vector<int> residuals(3 * 511 * 3);
+    for (size_t i = 0; i < residuals.size(); i++) { residuals[i] = static_cast<int>(i * 7919 % 511) - 255; }
+    vector<int> transformed = residuals;
+    forward_ycocg(transformed.data(), transformed.size() / 3);
+    inverse_ycocg(transformed.data(), transformed.size() / 3);
+    ASSERT_EQ(transformed, residuals);
+    // BGR frames are rebuilt exactly when their residuals are coded in YCoCg-R
+    cv::Mat mat(37, 53, CV_8UC3);
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(256));
+    Image image(mat);
+    image.set_color(BGR);
+    Frame frame{image};
+    frame.set_color_transform(true);
+    frame.encode_JPEG_LS();
+    InterHeader header;
+    header.width = 53;
+    header.height = 37;
+    header.color_space = BGR;
+    header.entropy_coder = CABAC;
+    header.color_transform = 1;
+    BitStream bs;
+    frame.write_frame(bs, CABAC, GolombParameters(), 0);
+    bs.flushBuffer();
+    BitStream in(bs.data(), bs.size());
+    const Frame decoded = Frame::read_frame(in, header, Slices(header.width, header.height, 1), nullptr);
+    Image im2 = decoded.get_image();
+    ASSERT_TRUE(image == im2);
+}
+
+TEST_F(FrameTest, InterStatisticsColorTransformTest) {
+    cv::Mat mat(16, 16, CV_8UC3, cv::Scalar::all(0));
+    Image image(mat);
+    image.set_color(BGR);
+    Frame frame{image};
+    frame.set_color_transform(true);
+    // Residuals with G alone are mostly Cg, and have no Co at all
+    MotionVector mv(0, 0);
+    mv.residual = cv::Mat(16, 16, CV_16SC3);
+    for (int row = 0; row < 16; row++) {
+        auto *pixel = mv.residual.ptr<int16_t>(row);
+        for (int i = 0; i < 16 * 3; i++) { pixel[i] = static_cast<int16_t>(i % 3 == 1 ? 40 : 0); }
+    }
+    frame.set_motion_vectors({mv});
+    GolombStatistics statistics;
+    statistics.add_inter(frame);
+    vector<int> coded(16 * 16 * 3);
+    for (size_t i = 0; i < coded.size(); i += 3) { coded[i + 1] = 40; }
+    forward_ycocg(coded.data(), coded.size() / 3);
+    GolombStatistics expected;
+    expected.add_temporal(coded, 3);
+    ASSERT_EQ(statistics.parameters().inter, expected.parameters().inter);
+    ASSERT_NE(statistics.parameters().inter[1], statistics.parameters().inter[2]);
+}
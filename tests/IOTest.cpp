@@ -1,9 +1,18 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <string>
+#include <vector>
 
+#include "../src/io/AsyncWriter.hpp"
 #include "../src/io/BitStream.hpp"
 #include "../src/io/Golomb.hpp"
+#include "../src/io/GolombEstimator.hpp"
+#include "../src/io/Cabac.hpp"
+#include "../src/io/Rans.hpp"
+#include "../src/io/Rice.hpp"
+#include "../src/io/SpeculativeGolomb.hpp"
 #include "../src/visual/Video.hpp"
 #include "../src/visual/YuvWriter.hpp"
 
@@ -22,6 +31,115 @@ TEST(IOTestSuite, BitStreamReadWriteTest) {
     delete bs;
 }
 
+TEST(IOTestSuite, BitStreamWideReadWriteTest) {
+    // Enough values to cross a few block boundaries
+    constexpr int count = 1 << 19;
+    auto *bs = new BitStream(golomb_dst, std::ios::out);
+    for (int i = 0; i < count; i++) {
+        const int n = i % BitStream::MAX_BITS + 1;
+        bs->writeBits(static_cast<uint64_t>(i) * 0x9E3779B97F4A7C15ULL, n);
+    }
+    delete bs;
+    bs = new BitStream(golomb_dst, std::ios::in);
+    for (int i = 0; i < count; i++) {
+        const int n = i % BitStream::MAX_BITS + 1;
+        const uint64_t expected = static_cast<uint64_t>(i) * 0x9E3779B97F4A7C15ULL & ((uint64_t{1} << n) - 1);
+        if (i % 2 == 0) {
+            ASSERT_EQ(bs->peekBits(n), expected);
+            bs->skipBits(n);
+        } else {
+            ASSERT_EQ(bs->readBits(n), expected);
+        }
+    }
+    delete bs;
+    remove(golomb_dst);
+}
+
+TEST(IOTestSuite, BitStreamMappedReadTest) {
+    auto *bs = new BitStream(golomb_dst, std::ios::out);
+    for (int i = 0; i < 1000; i++) { bs->writeBits(i, 13); }
+    delete bs;
+    bs = new BitStream(golomb_dst, std::ios::in);
+    ASSERT_TRUE(bs->isMapped());
+    for (int i = 0; i < 1000; i++) { ASSERT_EQ(bs->readBits(13), i); }
+    ASSERT_THROW(bs->readBits(8), std::runtime_error);
+    delete bs;
+    remove(golomb_dst);
+}
+
+TEST(IOTestSuite, BitStreamMemoryReadWriteTest) {
+    BitStream out;
+    Golomb g(&out);
+    g.set_m(4);
+    for (int i = -5000; i < 5000; i++) { g.encode(i); }
+    out.flushBuffer();
+    BitStream in(out.data(), out.size());
+    Golomb g2(&in);
+    g2.set_m(4);
+    for (int i = -5000; i < 5000; i++) { ASSERT_EQ(g2.decode(), i); }
+}
+
+TEST(IOTestSuite, BitStreamAsyncWriteTest) {
+    // A few blocks worth of data, so the queue is actually used
+    constexpr int count = 3 * BitStream::BLOCK_SIZE / 4;
+    auto *bs = new BitStream(golomb_dst, 2);
+    for (int i = 0; i < count; i++) { bs->writeBits(i, 32); }
+    ASSERT_NE(bs->getWriter(), nullptr);
+    ASSERT_LE(bs->getWriter()->getMaxQueueDepth(), 2);
+    delete bs;
+    bs = new BitStream(golomb_dst, std::ios::in);
+    for (int i = 0; i < count; i++) { ASSERT_EQ(bs->readBits(32), i); }
+    delete bs;
+    remove(golomb_dst);
+}
+
+TEST(IOTestSuite, BitStreamAsyncWriteErrorTest) {
+    // Every write to /dev/full fails, flushBuffer reports it and the destructor must not
+    auto *bs = new BitStream("/dev/full", 2);
+    bs->writeBits(1, 8);
+    ASSERT_THROW(bs->flushBuffer(), std::runtime_error);
+    bs->writeBits(1, 8);
+    delete bs;
+}
+
+TEST(IOTestSuite, BitStreamSeekTest) {
+    BitStream out;
+    for (int i = 0; i < 1000; i++) { out.writeBits(i, 13); }
+    out.flushBuffer();
+    BitStream in(out.data(), out.size());
+    for (const int i: {998, 3, 500, 0, 997}) {
+        in.seekBit(static_cast<uint64_t>(i) * 13);
+        ASSERT_EQ(in.readBits(13), i);
+        ASSERT_EQ(in.readBits(13), i + 1);
+        size_t size;
+        uint64_t bit;
+        in.readWindow(size, bit);
+        ASSERT_EQ(bit, static_cast<uint64_t>(i + 2) * 13);
+    }
+}
+
+TEST(IOTestSuite, BitStreamAppendTest) {
+    // Golomb codes aren't byte aligned, so the substreams start at arbitrary bit offsets
+    BitStream serial;
+    BitStream joined;
+    Golomb g_serial(&serial);
+    g_serial.set_m(3);
+    for (int segment = 0; segment < 20; segment++) {
+        BitStream part;
+        Golomb g_part(&part);
+        g_part.set_m(3);
+        for (int i = 0; i < segment * 37; i++) {
+            g_serial.encode(i - segment * 10);
+            g_part.encode(i - segment * 10);
+        }
+        joined.append(part);
+    }
+    serial.flushBuffer();
+    joined.flushBuffer();
+    ASSERT_EQ(serial.size(), joined.size());
+    ASSERT_EQ(memcmp(serial.data(), joined.data(), serial.size()), 0);
+}
+
 TEST(IOTestSuite, GolombReadWriteTest) {
     constexpr int m = 4;
     auto *g = new Golomb(golomb_dst, std::ios::out);
@@ -35,6 +153,239 @@ TEST(IOTestSuite, GolombReadWriteTest) {
     remove(golomb_dst);
 }
 
+TEST(IOTestSuite, GolombTableDecodeTest) {
+    // Covers codes resolved by the table, by the 32-bit window and bit by bit
+    for (const int m: {1, 2, 3, 4, 5, 8, 13, 16, 32, 100, 255}) {
+        BitStream out;
+        Golomb g(&out);
+        g.set_m(m);
+        for (int i = -300; i < 300; i++) { g.encode(i * i * (i % 7)); }
+        out.flushBuffer();
+        BitStream in(out.data(), out.size());
+        Golomb g2(&in);
+        g2.set_m(m);
+        for (int i = -300; i < 300; i++) { ASSERT_EQ(g2.decode(), i * i * (i % 7)) << "m = " << m; }
+    }
+}
+
+TEST(IOTestSuite, GolombEncodeTableTest) {
+    // Table codes must match computed codes, inside and outside the table's range
+    for (const int m: {1, 3, 5, 13, 100}) {
+        BitStream computed;
+        BitStream table;
+        Golomb g_computed(&computed);
+        Golomb g_table(&table);
+        g_computed.set_encode_range(0);
+        g_computed.set_m(m);
+        g_table.set_m(m);
+        for (int i = -200; i < 200; i++) {
+            g_computed.encode(i * (i % 3));
+            g_table.encode(i * (i % 3));
+        }
+        computed.flushBuffer();
+        table.flushBuffer();
+        ASSERT_EQ(computed.size(), table.size()) << "m = " << m;
+        ASSERT_EQ(memcmp(computed.data(), table.data(), table.size()), 0) << "m = " << m;
+    }
+}
+
+TEST(IOTestSuite, RiceMatchesGolombTest) {
+    for (int m = 1; m <= 128; m *= 2) {
+        BitStream golomb_out;
+        BitStream rice_out;
+        Golomb g(&golomb_out);
+        Rice rice(&rice_out);
+        g.set_m(m);
+        rice.set_m(m);
+        for (int i = -300; i < 300; i++) {
+            g.encode(i * i * (i % 7));
+            rice.encode(i * i * (i % 7));
+        }
+        golomb_out.flushBuffer();
+        rice_out.flushBuffer();
+        ASSERT_EQ(golomb_out.size(), rice_out.size()) << "m = " << m;
+        ASSERT_EQ(memcmp(golomb_out.data(), rice_out.data(), rice_out.size()), 0) << "m = " << m;
+        BitStream in(rice_out.data(), rice_out.size());
+        Rice rice_in(&in);
+        rice_in.set_m(m);
+        for (int i = -300; i < 300; i++) { ASSERT_EQ(rice_in.decode(), i * i * (i % 7)) << "m = " << m; }
+    }
+}
+
+TEST(IOTestSuite, GolombSpanTest) {
+    // Span codes must be bit-identical to per-symbol codes, including codes too long for the fast path
+    std::vector<int16_t> values;
+    for (int i = -3000; i < 3000; i++) { values.push_back(static_cast<int16_t>(i * (i % 11))); }
+    for (const int m: {1, 3, 4, 13, 64}) {
+        BitStream single;
+        BitStream span;
+        Golomb g(&single);
+        g.set_m(m);
+        for (const auto n: values) { g.encode(n); }
+        withGolombCoder(&span, m, [&values](const auto &coder) { coder.encode_span(values.data(), values.size()); });
+        single.flushBuffer();
+        span.flushBuffer();
+        ASSERT_EQ(single.size(), span.size()) << "m = " << m;
+        ASSERT_EQ(memcmp(single.data(), span.data(), span.size()), 0) << "m = " << m;
+        std::vector<int> decoded(values.size());
+        BitStream in(span.data(), span.size());
+        withGolombCoder(&in, m, [&decoded](auto &coder) { coder.decode_span(decoded.data(), decoded.size()); });
+        for (size_t i = 0; i < values.size(); i++) { ASSERT_EQ(decoded[i], values[i]) << "m = " << m; }
+    }
+    // File-backed streams cross block boundaries in the middle of a span
+    std::vector<int> large(4 * BitStream::BLOCK_SIZE);
+    for (size_t i = 0; i < large.size(); i++) { large[i] = static_cast<int>(i % 37) - 18; }
+    auto *bs = new BitStream(golomb_dst, std::ios::out);
+    Golomb g(bs);
+    g.set_m(5);
+    g.encode_span(large.data(), large.size());
+    delete bs;
+    bs = new BitStream(golomb_dst, std::ios::in);
+    Golomb g2(bs);
+    g2.set_m(5);
+    std::vector<int> decoded(large.size());
+    g2.decode_span(decoded.data(), decoded.size());
+    ASSERT_EQ(decoded, large);
+    delete bs;
+    remove(golomb_dst);
+}
+
+TEST(IOTestSuite, GolombLimitTest) {
+    // Escapes that fit in a word and longer ones, written and read one by one and as spans
+    std::vector<int> values;
+    for (int i = -2000; i < 2000; i++) { values.push_back(i % 5 == 0 ? i * 1000 : i % 40); }
+    for (const int limit: {1, 4, 24, 40}) {
+        for (const int m: {2, 3, 8}) {
+            BitStream single;
+            BitStream span;
+            Golomb g(&single);
+            g.set_limit(limit);
+            g.set_m(m);
+            for (const int n: values) { g.encode(n); }
+            withGolombCoder(&span, m, limit, [&values](const auto &coder) { coder.encode_span(values.data(), values.size()); });
+            single.flushBuffer();
+            span.flushBuffer();
+            ASSERT_EQ(single.size(), span.size()) << "m = " << m << ", limit = " << limit;
+            ASSERT_EQ(memcmp(single.data(), span.data(), span.size()), 0) << "m = " << m << ", limit = " << limit;
+            BitStream in(single.data(), single.size());
+            withGolombCoder(&in, m, limit, [&values](auto &coder) {
+                for (const int n: values) { ASSERT_EQ(coder.decode(), n); }
+            });
+            std::vector<int> decoded(values.size());
+            BitStream span_in(span.data(), span.size());
+            withGolombCoder(&span_in, m, limit, [&decoded](auto &coder) { coder.decode_span(decoded.data(), decoded.size()); });
+            ASSERT_EQ(decoded, values) << "m = " << m << ", limit = " << limit;
+        }
+    }
+}
+
+TEST(IOTestSuite, SpeculativeGolombTest) {
+    // The stitched values and the position reached must match the sequential decoder, whatever the chunks
+    std::vector<int> values(1 << 20);
+    uint32_t seed = 1;
+    for (int &n: values) {
+        seed = seed * 1664525u + 1013904223u;
+        const int magnitude = static_cast<int>(seed >> 24) % 23;
+        n = (seed & 1) != 0 ? -magnitude : seed % 997 == 0 ? static_cast<int>(seed >> 8) : magnitude;
+    }
+    for (const int m: {3, 8}) {
+        BitStream out;
+        withGolombCoder(&out, m, Golomb::DEFAULT_LIMIT, [&values](const auto &coder) { coder.encode_span(values.data(), values.size()); });
+        out.writeBits(0x2A, 8);
+        out.flushBuffer();
+        for (const int threads: {1, 2, 7}) {
+            for (const int candidates: {1, 3}) {
+                BitStream in(out.data(), out.size());
+                SpeculativeGolomb golomb(&in, m, Golomb::DEFAULT_LIMIT, threads, candidates);
+                std::vector<int> decoded(values.size());
+                golomb.decode_span(decoded.data(), decoded.size());
+                ASSERT_EQ(decoded, values) << "m = " << m << ", threads = " << threads;
+                ASSERT_EQ(in.readBits(8), 0x2A) << "m = " << m << ", threads = " << threads;
+            }
+        }
+    }
+}
+
+TEST(IOTestSuite, GolombEstimatorTest) {
+    // Values added one by one and as a span, in two estimators that are then merged
+    std::vector<int> values;
+    for (int i = 0; i < 5000; i++) { values.push_back((i * 7919 % 61 - 30) * (i % 3 + 1)); }
+    GolombEstimator first;
+    GolombEstimator second;
+    for (size_t i = 0; i < values.size() / 2; i++) { first.add(values[i]); }
+    second.add_span(values.data() + values.size() / 2, values.size() - values.size() / 2);
+    first.merge(second);
+    ASSERT_EQ(first.count(), values.size());
+    size_t best_size = SIZE_MAX;
+    for (int k = 0; k <= GolombEstimator::MAX_K; k++) {
+        BitStream bs;
+        withGolombCoder(&bs, 1 << k, [&values](const auto &coder) { coder.encode_span(values.data(), values.size()); });
+        bs.flushBuffer();
+        ASSERT_EQ((first.bits(k) + 7) / 8, bs.size()) << "k = " << k;
+        best_size = std::min(best_size, bs.size());
+    }
+    ASSERT_EQ((first.bits(first.best_k()) + 7) / 8, best_size);
+    ASSERT_EQ(first.best_m(), 1 << first.best_k());
+}
+
+TEST(IOTestSuite, RansTest) {
+    // Small values, escaped ones of every length and an empty block, read back in the same order
+    std::vector<int> values;
+    for (int i = 0; i < 100000; i++) { values.push_back((i * 7919 % 61 - 30) / (i % 7 + 1)); }
+    for (int shift = 0; shift < 31; shift++) {
+        values.push_back(1 << shift);
+        values.push_back(-(1 << shift) - 1);
+    }
+    values.push_back(INT32_MAX);
+    values.push_back(INT32_MIN);
+    BitStream bs;
+    Rans encoder;
+    encoder.encode_span(values.data(), values.size());
+    encoder.write(bs);
+    encoder.write(bs);
+    encoder.encode(-3);
+    encoder.write(bs);
+    bs.flushBuffer();
+    BitStream in(bs.data(), bs.size());
+    Rans decoder;
+    decoder.read(in);
+    std::vector<int> decoded(values.size());
+    decoder.decode_span(decoded.data(), decoded.size());
+    ASSERT_EQ(decoded, values);
+    decoder.read(in);
+    decoder.read(in);
+    ASSERT_EQ(decoder.decode(), -3);
+}
+
+TEST(IOTestSuite, CabacTest) {
+    // Long prefixes, suffixes of every length, an empty block and a block after it, read back in the same order
+    std::vector<int> values;
+    for (int i = 0; i < 100000; i++) { values.push_back((i * 7919 % 61 - 30) / (i % 7 + 1)); }
+    for (int shift = 0; shift < 31; shift++) {
+        values.push_back(1 << shift);
+        values.push_back(-(1 << shift) - 1);
+    }
+    values.push_back(INT32_MAX);
+    values.push_back(INT32_MIN);
+    BitStream bs;
+    Cabac encoder;
+    encoder.encode_span(values.data(), values.size());
+    encoder.write(bs);
+    encoder.write(bs);
+    encoder.encode(-3);
+    encoder.write(bs);
+    bs.flushBuffer();
+    BitStream in(bs.data(), bs.size());
+    Cabac decoder;
+    decoder.read(in);
+    std::vector<int> decoded(values.size());
+    decoder.decode_span(decoded.data(), decoded.size());
+    ASSERT_EQ(decoded, values);
+    decoder.read(in);
+    decoder.read(in);
+    ASSERT_EQ(decoder.decode(), -3);
+}
+
 TEST(IOTestSuite, YUV444WriteReadTest) {
     auto original_path = "../../tests/resource/ducks_take_off_444_720p50.y4m";
     Video yuv(original_path);